@@ -0,0 +1,213 @@
+#include "compressed_postings.h"
+#include <algorithm>
+// The SIMD decoder is compiled for SSSE3 on its own, whatever the flags of the build, and used only on
+// processors that support it.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define STREAMVBYTE_SSSE3
+#include <tmmintrin.h>
+#endif
+using namespace std;
+
+namespace {
+
+// The SIMD decoder loads 16 bytes at a time, so the data stream is padded to keep the last loads in bounds.
+const size_t DATA_PADDING = 16;
+
+void EncodeStreamVByte(const uint32_t* values, size_t count, vector<uint8_t>& out) {
+	const size_t control_offset = out.size();
+	out.resize(out.size() + (count + 3) / 4);
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t value = values[i];
+		const int length = value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+		out[control_offset + i / 4] |= static_cast<uint8_t>((length - 1) << (i % 4 * 2));
+		for (int byte = 0; byte < length; ++byte) {
+			out.push_back(static_cast<uint8_t>(value));
+			value >>= 8;
+		}
+	}
+}
+
+#ifdef STREAMVBYTE_SSSE3
+struct ShuffleTables {
+	array<array<uint8_t, 16>, 256> masks;
+	array<uint8_t, 256> lengths;
+
+	ShuffleTables() {
+		for (int control = 0; control < 256; ++control) {
+			uint8_t offset = 0;
+			for (int value = 0; value < 4; ++value) {
+				const int length = ((control >> (value * 2)) & 3) + 1;
+				for (int byte = 0; byte < 4; ++byte) {
+					masks[control][value * 4 + byte] = byte < length ? static_cast<uint8_t>(offset + byte) : 0x80;
+				}
+				offset += length;
+			}
+			lengths[control] = offset;
+		}
+	}
+};
+
+const ShuffleTables& GetShuffleTables() {
+	static const ShuffleTables tables;
+	return tables;
+}
+
+bool HasSsse3() {
+	static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+	return has_ssse3;
+}
+
+// Decodes the whole groups of four values and returns how many values it decoded.
+__attribute__((target("ssse3")))
+size_t DecodeGroupsSsse3(const uint8_t* control, size_t count, const uint8_t*& data, uint32_t* values) {
+	const ShuffleTables& tables = GetShuffleTables();
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const uint8_t group_control = control[i / 4];
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+		const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.masks[group_control].data()));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_shuffle_epi8(bytes, mask));
+		data += tables.lengths[group_control];
+	}
+	return i;
+}
+#endif
+
+const uint8_t* DecodeStreamVByte(const uint8_t* in, size_t count, uint32_t* values) {
+	const uint8_t* control = in;
+	const uint8_t* data = in + (count + 3) / 4;
+	size_t i = 0;
+#ifdef STREAMVBYTE_SSSE3
+	if (HasSsse3()) {
+		i = DecodeGroupsSsse3(control, count, data, values);
+	}
+#endif
+	for (; i < count; ++i) {
+		const int length = ((control[i / 4] >> (i % 4 * 2)) & 3) + 1;
+		uint32_t value = 0;
+		for (int byte = 0; byte < length; ++byte) {
+			value |= static_cast<uint32_t>(data[byte]) << (byte * 8);
+		}
+		data += length;
+		values[i] = value;
+	}
+	return data;
+}
+
+} // namespace
+
+CompressedPostingList::CompressedPostingList(const vector<int>& document_ids, const vector<uint32_t>& counts)
+	: size_(document_ids.size())
+{
+	array<uint32_t, BLOCK_SIZE> deltas;
+	int previous_document_id = 0;
+	for (size_t first = 0; first < size_; first += BLOCK_SIZE) {
+		const size_t block_size = min(BLOCK_SIZE, size_ - first);
+		blocks_.push_back({ document_ids[first + block_size - 1], static_cast<uint32_t>(data_.size()) });
+		for (size_t i = 0; i < block_size; ++i) {
+			deltas[i] = static_cast<uint32_t>(document_ids[first + i]) - static_cast<uint32_t>(previous_document_id);
+			previous_document_id = document_ids[first + i];
+		}
+		EncodeStreamVByte(deltas.data(), block_size, data_);
+		EncodeStreamVByte(counts.data() + first, block_size, data_);
+	}
+	data_.resize(data_.size() + DATA_PADDING);
+	data_.shrink_to_fit();
+	blocks_.shrink_to_fit();
+}
+
+size_t CompressedPostingList::Size() const {
+	return size_;
+}
+
+bool CompressedPostingList::Empty() const {
+	return size_ == 0;
+}
+
+size_t CompressedPostingList::GetMemoryUsage() const {
+	return sizeof(*this) + blocks_.capacity() * sizeof(BlockHeader) + data_.capacity();
+}
+
+void CompressedPostingList::Decode(vector<int>& document_ids, vector<uint32_t>& counts) const {
+	document_ids.resize(size_);
+	counts.resize(size_);
+	vector<uint32_t> block_document_ids(BLOCK_SIZE);
+	for (size_t block = 0; block < blocks_.size(); ++block) {
+		const size_t first = block * BLOCK_SIZE;
+		DecodeBlock(block, block_document_ids.data(), counts.data() + first);
+		copy_n(block_document_ids.begin(), GetBlockSize(block), document_ids.begin() + first);
+	}
+}
+
+size_t CompressedPostingList::GetBlockSize(size_t block) const {
+	return min(BLOCK_SIZE, size_ - block * BLOCK_SIZE);
+}
+
+void CompressedPostingList::DecodeBlock(size_t block, uint32_t* document_ids, uint32_t* counts) const {
+	const size_t block_size = GetBlockSize(block);
+	const uint8_t* in = data_.data() + blocks_[block].data_offset;
+	in = DecodeStreamVByte(in, block_size, document_ids);
+	DecodeStreamVByte(in, block_size, counts);
+
+	uint32_t document_id = block == 0 ? 0 : static_cast<uint32_t>(blocks_[block - 1].last_document_id);
+	for (size_t i = 0; i < block_size; ++i) {
+		document_id += document_ids[i];
+		document_ids[i] = document_id;
+	}
+}
+
+CompressedPostingList::Cursor::Cursor(const CompressedPostingList& postings)
+	: postings_(&postings)
+{
+	if (!postings_->Empty()) {
+		LoadBlock(0);
+	}
+}
+
+bool CompressedPostingList::Cursor::IsEnd() const {
+	return block_ >= postings_->blocks_.size();
+}
+
+int CompressedPostingList::Cursor::GetDocumentId() const {
+	return static_cast<int>(document_ids_[position_]);
+}
+
+uint32_t CompressedPostingList::Cursor::GetCount() const {
+	return counts_[position_];
+}
+
+void CompressedPostingList::Cursor::Next() {
+	if (++position_ == block_size_) {
+		if (++block_ < postings_->blocks_.size()) {
+			LoadBlock(block_);
+		}
+	}
+}
+
+void CompressedPostingList::Cursor::SeekTo(int document_id) {
+	if (IsEnd()) {
+		return;
+	}
+	const auto& blocks = postings_->blocks_;
+	if (blocks[block_].last_document_id < document_id) {
+		const auto it = partition_point(blocks.begin() + block_ + 1, blocks.end(), [document_id](const BlockHeader& header) {
+			return header.last_document_id < document_id;
+		});
+		block_ = it - blocks.begin();
+		if (IsEnd()) {
+			return;
+		}
+		LoadBlock(block_);
+	}
+	const auto it = partition_point(document_ids_.begin() + position_, document_ids_.begin() + block_size_, [document_id](uint32_t current) {
+		return static_cast<int>(current) < document_id;
+	});
+	position_ = it - document_ids_.begin();
+}
+
+void CompressedPostingList::Cursor::LoadBlock(size_t block) {
+	block_ = block;
+	position_ = 0;
+	block_size_ = postings_->GetBlockSize(block);
+	postings_->DecodeBlock(block, document_ids_.data(), counts_.data());
+}
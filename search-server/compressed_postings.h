@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Read-only posting list packed in blocks of BLOCK_SIZE postings.
+// Document ids are delta-encoded and, like the per-document term counts, stored in
+// the StreamVByte layout: a 2-bit length per value in a control stream, then 1-4 data bytes.
+// Every block is addressed through a skip table of its last document id.
+class CompressedPostingList {
+public:
+	static constexpr size_t BLOCK_SIZE = 128;
+
+	class Cursor {
+	public:
+		explicit Cursor(const CompressedPostingList& postings);
+
+		bool IsEnd() const;
+		int GetDocumentId() const;
+		uint32_t GetCount() const;
+
+		void Next();
+		// Moves to the first posting whose document id is not less than document_id, skipping whole blocks.
+		void SeekTo(int document_id);
+
+	private:
+		const CompressedPostingList* postings_;
+		size_t block_ = 0;
+		size_t position_ = 0;
+		size_t block_size_ = 0;
+		std::array<uint32_t, BLOCK_SIZE> document_ids_;
+		std::array<uint32_t, BLOCK_SIZE> counts_;
+
+		void LoadBlock(size_t block);
+	};
+
+	CompressedPostingList() = default;
+	CompressedPostingList(const std::vector<int>& document_ids, const std::vector<uint32_t>& counts);
+
+	size_t Size() const;
+	bool Empty() const;
+	size_t GetMemoryUsage() const;
+
+	void Decode(std::vector<int>& document_ids, std::vector<uint32_t>& counts) const;
+
+private:
+	struct BlockHeader {
+		int last_document_id;
+		uint32_t data_offset;
+	};
+
+	size_t size_ = 0;
+	std::vector<BlockHeader> blocks_;
+	std::vector<uint8_t> data_;
+
+	size_t GetBlockSize(size_t block) const;
+	void DecodeBlock(size_t block, uint32_t* document_ids, uint32_t* counts) const;
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+// Lock-free open-addressing table that sums values per key from many threads.
+// The minimal Key value is reserved as the empty slot marker.
+template <typename Key, typename Value>
+class ConcurrentAccumulator {
+public:
+    static_assert(std::is_integral_v<Key>, "ConcurrentAccumulator supports only integer keys");
+    static_assert(std::is_arithmetic_v<Value>, "ConcurrentAccumulator supports only arithmetic values");
+
+    explicit ConcurrentAccumulator(size_t expected_key_count)
+        : capacity_(ComputeCapacity(expected_key_count))
+        , slots_(std::make_unique<Slot[]>(capacity_))
+    {
+    }
+
+    void Add(Key key, Value delta) {
+        std::atomic<Value>& value = FindOrInsert(key).value;
+        Value current = value.load(std::memory_order_relaxed);
+        while (!value.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {
+        }
+    }
+
+    template <typename Function>
+    void ForEach(Function function) const {
+        for (size_t i = 0; i < capacity_; ++i) {
+            const Slot& slot = slots_[i];
+            const Key key = slot.key.load(std::memory_order_acquire);
+            if (key != EMPTY_KEY) {
+                function(key, slot.value.load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+private:
+    static constexpr Key EMPTY_KEY = std::numeric_limits<Key>::min();
+
+    struct Slot {
+        std::atomic<Key> key = EMPTY_KEY;
+        std::atomic<Value> value = Value{};
+    };
+
+    size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+
+    static size_t ComputeCapacity(size_t expected_key_count) {
+        size_t capacity = 16;
+        while (capacity < expected_key_count * 2) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    Slot& FindOrInsert(Key key) {
+        const size_t mask = capacity_ - 1;
+        size_t index = static_cast<size_t>(static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull >> 32) & mask;
+        while (true) {
+            Slot& slot = slots_[index];
+            Key current = slot.key.load(std::memory_order_acquire);
+            if (current == key) {
+                return slot;
+            }
+            if (current == EMPTY_KEY) {
+                if (slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel) || current == key) {
+                    return slot;
+                }
+            }
+            index = (index + 1) & mask;
+        }
+    }
+};
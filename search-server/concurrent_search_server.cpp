@@ -0,0 +1,104 @@
+#include "concurrent_search_server.h"
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+using namespace std;
+
+ConcurrentSearchServer::ConcurrentSearchServer(const string& stop_words_text)
+	: ConcurrentSearchServer(SplitIntoWords(stop_words_text))
+{
+}
+
+ConcurrentSearchServer::ConcurrentSearchServer(const string_view stop_words_text)
+	: ConcurrentSearchServer(SplitIntoWords(stop_words_text))
+{
+}
+
+ConcurrentSearchServer::Snapshot ConcurrentSearchServer::GetSnapshot() const {
+	return atomic_load(&published_);
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+	return GetSnapshot()->GetDocumentCount();
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, const string_view document, DocumentStatus status, const vector<int>& ratings) {
+	Write([&](SearchServer& search_server) {
+		search_server.AddDocument(document_id, document, status, ratings);
+	});
+}
+
+void ConcurrentSearchServer::AddDocuments(const vector<NewDocument>& documents) {
+	Write([&](SearchServer& search_server) {
+		search_server.AddDocuments(documents);
+	});
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+	Write([&](SearchServer& search_server) {
+		search_server.RemoveDocument(document_id);
+	});
+}
+
+// Every publication gets its own control block, whose deleter runs once all of its readers are gone.
+void ConcurrentSearchServer::Publish(size_t instance) {
+	shared_ptr<Instance> published_instance = instances_[instance];
+	{
+		lock_guard<mutex> lock(published_instance->release_mutex);
+		published_instance->is_released = false;
+	}
+	const SearchServer* search_server = &published_instance->server;
+	atomic_store(&published_, Snapshot(search_server, [published_instance = move(published_instance)](const SearchServer*) {
+		{
+			lock_guard<mutex> lock(published_instance->release_mutex);
+			published_instance->is_released = true;
+		}
+		published_instance->released.notify_one();
+	}));
+}
+
+void ConcurrentSearchServer::Write(const function<void(SearchServer&)>& update) {
+	lock_guard<mutex> lock(write_mutex_);
+	if (is_standby_stale_) {
+		RebuildStandby();
+	}
+	// A failed update leaves the standby copy unchanged, so nothing is published.
+	update(instances_[standby_]->server);
+	Publish(standby_);
+
+	standby_ ^= 1;
+	Instance& previous = *instances_[standby_];
+	{
+		unique_lock<mutex> release_lock(previous.release_mutex);
+		previous.released.wait(release_lock, [&previous] {
+			return previous.is_released;
+		});
+	}
+	// The update is already published, so a failure here is not reported: the update succeeded on an
+	// identical copy, and only running out of resources can make it fail on this one.
+	try {
+		update(previous.server);
+	}
+	catch (...) {
+		is_standby_stale_ = true;
+	}
+	if (is_standby_stale_) {
+		try {
+			RebuildStandby();
+		}
+		catch (...) {
+			// Retried by the next write before it changes anything.
+		}
+	}
+}
+
+void ConcurrentSearchServer::RebuildStandby() {
+	const string path = (filesystem::temp_directory_path()
+		/ ("concurrent_search_server_"s + to_string(reinterpret_cast<uintptr_t>(this)) + ".snapshot"s)).string();
+	GetSnapshot()->SaveSnapshot(path);
+	// A loaded server keeps the file mapped, which outlives the name of the file.
+	shared_ptr<Instance> instance = make_shared<Instance>(Instance::LoadFrom{ path });
+	remove(path.c_str());
+	instances_[standby_] = move(instance);
+	is_standby_stale_ = false;
+}
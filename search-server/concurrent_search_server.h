@@ -0,0 +1,86 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "document.h"
+#include "search_server.h"
+
+// Serves queries while documents are being added or removed.
+// Two full copies of the index are kept, so the server takes twice the memory of a SearchServer and
+// every write is done twice. Readers take the published copy as an immutable snapshot and never wait;
+// a writer updates the other copy, publishes it, and repeats the update on the previous copy as soon
+// as the last reader of that copy has released it. If the repeated update fails, the previous copy
+// is rebuilt from a snapshot of the published one.
+class ConcurrentSearchServer {
+public:
+	using Snapshot = std::shared_ptr<const SearchServer>;
+
+	template <typename StringContainer>
+	explicit ConcurrentSearchServer(const StringContainer& stop_words);
+	explicit ConcurrentSearchServer(const std::string& stop_words_text);
+	explicit ConcurrentSearchServer(std::string_view stop_words_text);
+
+	// The snapshot stays unchanged for as long as it is held, so holding it delays the next write.
+	Snapshot GetSnapshot() const;
+
+	template <typename... Args>
+	std::vector<Document> FindTopDocuments(Args&&... args) const;
+	int GetDocumentCount() const;
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+	void AddDocuments(const std::vector<NewDocument>& documents);
+	void RemoveDocument(int document_id);
+
+private:
+	struct Instance {
+		template <typename StringContainer>
+		explicit Instance(const StringContainer& stop_words)
+			: server(stop_words)
+		{
+		}
+
+		struct LoadFrom {
+			const std::string& snapshot_path;
+		};
+
+		// The server is loaded in place: a SearchServer refers to its own stop words and cannot be moved.
+		explicit Instance(LoadFrom load_from)
+			: server(SearchServer::LoadSnapshot(load_from.snapshot_path))
+		{
+		}
+
+		SearchServer server;
+		std::mutex release_mutex;
+		std::condition_variable released;
+		// Set when the last snapshot of this instance is released.
+		bool is_released = true;
+	};
+
+	std::mutex write_mutex_;
+	std::shared_ptr<Instance> instances_[2];
+	Snapshot published_;
+	size_t standby_ = 1;
+	// Set when the standby copy may differ from the published one; the next write rebuilds it first.
+	bool is_standby_stale_ = false;
+
+	void Publish(size_t instance);
+	void Write(const std::function<void(SearchServer&)>& update);
+	void RebuildStandby();
+};
+
+template <typename StringContainer>
+ConcurrentSearchServer::ConcurrentSearchServer(const StringContainer& stop_words)
+	: instances_{ std::make_shared<Instance>(stop_words), std::make_shared<Instance>(stop_words) }
+{
+	Publish(0);
+}
+
+template <typename... Args>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(Args&&... args) const {
+	return GetSnapshot()->FindTopDocuments(std::forward<Args>(args)...);
+}
@@ -8,6 +8,17 @@ Document::Document(int id, double relevance, int rating)
 {
 }
 
+int ComputeAverageRating(const vector<int>& ratings) {
+	if (ratings.empty()) {
+		return 0;
+	}
+	int rating_sum = 0;
+	for (const int rating : ratings) {
+		rating_sum += rating;
+	}
+	return rating_sum / static_cast<int>(ratings.size());
+}
+
 void PrintDocument(const Document& document) {
 	cout << "{ "s
 		<< "document_id = "s << document.id << ", "s
@@ -19,6 +19,8 @@ struct Document {
 	int rating = 0;
 };
 
+int ComputeAverageRating(const std::vector<int>& ratings);
+
 void PrintDocument(const Document& document);
 
 void PrintMatchDocumentResult(int document_id, const std::vector<std::string>& words, DocumentStatus status);
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "document_bitmap.h"
+#include <algorithm>
+#include <iterator>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+void DocumentBitmap::Add(uint32_t value) {
+	const uint16_t key = static_cast<uint16_t>(value >> 16);
+	const uint16_t low = static_cast<uint16_t>(value);
+	auto it = lower_bound(containers_.begin(), containers_.end(), key, [](const Container& container, uint16_t key) {
+		return container.key < key;
+	});
+	if (it == containers_.end() || it->key != key) {
+		it = containers_.insert(it, Container{});
+		it->key = key;
+	}
+	Container& container = *it;
+	if (container.IsDense()) {
+		uint64_t& word = container.words[low / 64];
+		const uint64_t bit = uint64_t{ 1 } << (low % 64);
+		if ((word & bit) == 0) {
+			word |= bit;
+			++container.cardinality;
+		}
+		return;
+	}
+	// Ordinals mostly grow, so the common case is an append.
+	if (container.values.empty() || container.values.back() < low) {
+		container.values.push_back(low);
+	}
+	else {
+		const auto position = lower_bound(container.values.begin(), container.values.end(), low);
+		if (*position == low) {
+			return;
+		}
+		container.values.insert(position, low);
+	}
+	++container.cardinality;
+	if (container.cardinality > ARRAY_LIMIT) {
+		container.ToDense();
+	}
+}
+
+bool DocumentBitmap::Remove(uint32_t value) {
+	const uint16_t key = static_cast<uint16_t>(value >> 16);
+	const uint16_t low = static_cast<uint16_t>(value);
+	const auto it = lower_bound(containers_.begin(), containers_.end(), key, [](const Container& container, uint16_t key) {
+		return container.key < key;
+	});
+	if (it == containers_.end() || it->key != key || !it->Contains(low)) {
+		return false;
+	}
+	Container& container = *it;
+	if (container.IsDense()) {
+		container.words[low / 64] &= ~(uint64_t{ 1 } << (low % 64));
+	}
+	else {
+		container.values.erase(lower_bound(container.values.begin(), container.values.end(), low));
+	}
+	if (--container.cardinality == 0) {
+		containers_.erase(it);
+	}
+	else {
+		container.Shrink();
+	}
+	return true;
+}
+
+bool DocumentBitmap::Contains(uint32_t value) const {
+	const Container* container = FindContainer(static_cast<uint16_t>(value >> 16));
+	return container != nullptr && container->Contains(static_cast<uint16_t>(value));
+}
+
+bool DocumentBitmap::Empty() const {
+	return containers_.empty();
+}
+
+size_t DocumentBitmap::GetCardinality() const {
+	size_t cardinality = 0;
+	for (const Container& container : containers_) {
+		cardinality += container.cardinality;
+	}
+	return cardinality;
+}
+
+void DocumentBitmap::Clear() {
+	containers_.clear();
+}
+
+void DocumentBitmap::UnionWith(const DocumentBitmap& other) {
+	vector<Container> merged;
+	merged.reserve(containers_.size() + other.containers_.size());
+	auto it = containers_.begin();
+	for (const Container& other_container : other.containers_) {
+		for (; it != containers_.end() && it->key < other_container.key; ++it) {
+			merged.push_back(move(*it));
+		}
+		if (it == containers_.end() || it->key != other_container.key) {
+			merged.push_back(other_container);
+			continue;
+		}
+		Container& container = merged.emplace_back(move(*it++));
+		if (!container.IsDense() && !other_container.IsDense()) {
+			vector<uint16_t> values;
+			values.reserve(container.values.size() + other_container.values.size());
+			set_union(container.values.begin(), container.values.end(), other_container.values.begin(), other_container.values.end(), back_inserter(values));
+			container.values = move(values);
+			container.cardinality = static_cast<uint32_t>(container.values.size());
+			if (container.cardinality > ARRAY_LIMIT) {
+				container.ToDense();
+			}
+			continue;
+		}
+		container.ToDense();
+		if (other_container.IsDense()) {
+			for (size_t word = 0; word < BITMAP_WORD_COUNT; ++word) {
+				container.words[word] |= other_container.words[word];
+			}
+		}
+		else {
+			for (const uint16_t value : other_container.values) {
+				container.words[value / 64] |= uint64_t{ 1 } << (value % 64);
+			}
+		}
+		container.cardinality = 0;
+		for (const uint64_t word : container.words) {
+			container.cardinality += CountBits(word);
+		}
+	}
+	move(it, containers_.end(), back_inserter(merged));
+	containers_ = move(merged);
+}
+
+void DocumentBitmap::IntersectWith(const DocumentBitmap& other) {
+	vector<Container> intersection;
+	for (Container& container : containers_) {
+		const Container* other_container = other.FindContainer(container.key);
+		if (other_container == nullptr) {
+			continue;
+		}
+		if (container.IsDense() && other_container->IsDense()) {
+			container.cardinality = 0;
+			for (size_t word = 0; word < BITMAP_WORD_COUNT; ++word) {
+				container.words[word] &= other_container->words[word];
+				container.cardinality += CountBits(container.words[word]);
+			}
+		}
+		else {
+			// A sparse side bounds the result, so it is filtered by the other one.
+			const Container& sparse = container.IsDense() ? *other_container : container;
+			const Container& filter = container.IsDense() ? container : *other_container;
+			vector<uint16_t> values;
+			copy_if(sparse.values.begin(), sparse.values.end(), back_inserter(values), [&filter](uint16_t value) {
+				return filter.Contains(value);
+			});
+			container.words.clear();
+			container.values = move(values);
+			container.cardinality = static_cast<uint32_t>(container.values.size());
+		}
+		if (container.cardinality > 0) {
+			container.Shrink();
+			intersection.push_back(move(container));
+		}
+	}
+	containers_ = move(intersection);
+}
+
+size_t DocumentBitmap::GetMemoryUsage() const {
+	size_t usage = containers_.capacity() * sizeof(Container);
+	for (const Container& container : containers_) {
+		usage += container.values.capacity() * sizeof(uint16_t) + container.words.capacity() * sizeof(uint64_t);
+	}
+	return usage;
+}
+
+bool DocumentBitmap::Container::IsDense() const {
+	return !words.empty();
+}
+
+bool DocumentBitmap::Container::Contains(uint16_t value) const {
+	if (IsDense()) {
+		return (words[value / 64] >> (value % 64)) & 1;
+	}
+	return binary_search(values.begin(), values.end(), value);
+}
+
+void DocumentBitmap::Container::ToDense() {
+	if (IsDense()) {
+		return;
+	}
+	words.assign(BITMAP_WORD_COUNT, 0);
+	for (const uint16_t value : values) {
+		words[value / 64] |= uint64_t{ 1 } << (value % 64);
+	}
+	values = {};
+}
+
+void DocumentBitmap::Container::Shrink() {
+	if (!IsDense() || cardinality > ARRAY_LIMIT) {
+		return;
+	}
+	values.reserve(cardinality);
+	for (size_t word = 0; word < BITMAP_WORD_COUNT; ++word) {
+		for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1) {
+			values.push_back(static_cast<uint16_t>(word * 64 + CountTrailingZeros(bits)));
+		}
+	}
+	words = {};
+}
+
+const DocumentBitmap::Container* DocumentBitmap::FindContainer(uint16_t key) const {
+	const auto it = lower_bound(containers_.begin(), containers_.end(), key, [](const Container& container, uint16_t key) {
+		return container.key < key;
+	});
+	return it != containers_.end() && it->key == key ? &*it : nullptr;
+}
+
+int DocumentBitmap::CountTrailingZeros(uint64_t bits) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+int DocumentBitmap::CountBits(uint64_t bits) {
+#if defined(_MSC_VER)
+	return static_cast<int>(__popcnt64(bits));
+#else
+	return __builtin_popcountll(bits);
+#endif
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compressed set of document ordinals in the style of Roaring bitmaps. Values are grouped by their
+// high 16 bits; a group keeps its low bits in a sorted array while it is sparse and switches to a
+// bitmap of 65536 bits once it holds more than ARRAY_LIMIT values. Set operations then work on
+// whole 64-bit words of dense groups.
+class DocumentBitmap {
+public:
+	static constexpr size_t ARRAY_LIMIT = 4096;
+
+	void Add(uint32_t value);
+	bool Remove(uint32_t value);
+	bool Contains(uint32_t value) const;
+
+	bool Empty() const;
+	size_t GetCardinality() const;
+	void Clear();
+
+	void UnionWith(const DocumentBitmap& other);
+	void IntersectWith(const DocumentBitmap& other);
+
+	// Calls function(value) in increasing order of values.
+	template <typename Function>
+	void ForEach(Function function) const;
+	// Same for the values in [first, last).
+	template <typename Function>
+	void ForEachInRange(uint32_t first, uint32_t last, Function function) const;
+
+	// Bytes allocated by the bitmap, not counting the object itself.
+	size_t GetMemoryUsage() const;
+
+private:
+	static constexpr size_t BITMAP_WORD_COUNT = (1 << 16) / 64;
+
+	struct Container {
+		uint16_t key = 0;
+		uint32_t cardinality = 0;
+		// Sorted low bits of a sparse container.
+		std::vector<uint16_t> values;
+		// Bits of a dense container; empty while the container is sparse.
+		std::vector<uint64_t> words;
+
+		bool IsDense() const;
+		bool Contains(uint16_t value) const;
+		void ToDense();
+		// Makes the container sparse if it is small enough.
+		void Shrink();
+	};
+
+	// Sorted by key.
+	std::vector<Container> containers_;
+
+	const Container* FindContainer(uint16_t key) const;
+
+	static int CountTrailingZeros(uint64_t bits);
+	static int CountBits(uint64_t bits);
+};
+
+template <typename Function>
+void DocumentBitmap::ForEach(Function function) const {
+	for (const Container& container : containers_) {
+		const uint32_t high = static_cast<uint32_t>(container.key) << 16;
+		if (!container.IsDense()) {
+			for (const uint16_t value : container.values) {
+				function(high | value);
+			}
+			continue;
+		}
+		for (uint32_t word = 0; word < BITMAP_WORD_COUNT; ++word) {
+			for (uint64_t bits = container.words[word]; bits != 0; bits &= bits - 1) {
+				function(high | (word * 64 + CountTrailingZeros(bits)));
+			}
+		}
+	}
+}
+
+template <typename Function>
+void DocumentBitmap::ForEachInRange(uint32_t first, uint32_t last, Function function) const {
+	if (first >= last) {
+		return;
+	}
+	auto container = containers_.begin();
+	while (container != containers_.end() && container->key < (first >> 16)) {
+		++container;
+	}
+	for (; container != containers_.end() && container->key <= ((last - 1) >> 16); ++container) {
+		const uint32_t high = static_cast<uint32_t>(container->key) << 16;
+		// Bounds of the range within the container, inclusive.
+		const uint32_t low_first = container->key == (first >> 16) ? first & 0xFFFF : 0;
+		const uint32_t low_last = container->key == ((last - 1) >> 16) ? (last - 1) & 0xFFFF : 0xFFFF;
+		if (!container->IsDense()) {
+			auto value = container->values.begin();
+			if (low_first > 0) {
+				value = std::lower_bound(value, container->values.end(), static_cast<uint16_t>(low_first));
+			}
+			for (; value != container->values.end() && *value <= low_last; ++value) {
+				function(high | *value);
+			}
+			continue;
+		}
+		for (uint32_t word = low_first / 64; word <= low_last / 64; ++word) {
+			uint64_t bits = container->words[word];
+			if (word == low_first / 64) {
+				bits &= ~uint64_t{ 0 } << (low_first % 64);
+			}
+			if (word == low_last / 64 && low_last % 64 != 63) {
+				bits &= (uint64_t{ 1 } << (low_last % 64 + 1)) - 1;
+			}
+			for (; bits != 0; bits &= bits - 1) {
+				function(high | (word * 64 + CountTrailingZeros(bits)));
+			}
+		}
+	}
+}
@@ -0,0 +1,146 @@
+#include "index_segment.h"
+#include <tuple>
+using namespace std;
+
+IndexSegment::IndexSegment(vector<SegmentDocument> documents, const vector<vector<SegmentTermCount>>& document_terms)
+	: documents_(move(documents))
+	, tombstones_(make_unique<atomic<uint64_t>[]>((documents_.size() + 63) / 64))
+{
+	vector<tuple<TermId, int, uint32_t>> postings;
+	document_term_offsets_.reserve(documents_.size() + 1);
+	document_term_offsets_.push_back(0);
+	for (size_t ordinal = 0; ordinal < documents_.size(); ++ordinal) {
+		ordinals_[documents_[ordinal].id] = static_cast<int>(ordinal);
+		for (const SegmentTermCount& term : document_terms[ordinal]) {
+			document_terms_.push_back(term);
+			postings.emplace_back(term.term_id, static_cast<int>(ordinal), term.count);
+		}
+		document_term_offsets_.push_back(static_cast<uint32_t>(document_terms_.size()));
+	}
+	sort(postings.begin(), postings.end());
+
+	vector<int> ordinals;
+	vector<uint32_t> counts;
+	for (size_t first = 0; first < postings.size();) {
+		const TermId term_id = get<0>(postings[first]);
+		ordinals.clear();
+		counts.clear();
+		size_t last = first;
+		for (; last < postings.size() && get<0>(postings[last]) == term_id; ++last) {
+			ordinals.push_back(get<1>(postings[last]));
+			counts.push_back(get<2>(postings[last]));
+		}
+		term_ids_.push_back(term_id);
+		postings_.emplace_back(ordinals, counts);
+		first = last;
+	}
+}
+
+IndexSegment IndexSegment::Merge(const vector<const IndexSegment*>& segments, vector<vector<int>>& new_ordinals) {
+	vector<SegmentDocument> documents;
+	vector<vector<SegmentTermCount>> document_terms;
+	new_ordinals.clear();
+	for (const IndexSegment* segment : segments) {
+		vector<int>& segment_ordinals = new_ordinals.emplace_back(segment->GetDocumentCount(), -1);
+		for (size_t ordinal = 0; ordinal < segment->GetDocumentCount(); ++ordinal) {
+			if (segment->IsDeleted(ordinal)) {
+				continue;
+			}
+			segment_ordinals[ordinal] = static_cast<int>(documents.size());
+			documents.push_back(segment->GetDocument(ordinal));
+			document_terms.push_back(segment->GetDocumentTerms(ordinal));
+		}
+	}
+	return IndexSegment(move(documents), document_terms);
+}
+
+size_t IndexSegment::GetDocumentCount() const {
+	return documents_.size();
+}
+
+size_t IndexSegment::GetLiveDocumentCount() const {
+	return documents_.size() - deleted_count_;
+}
+
+const SegmentDocument& IndexSegment::GetDocument(int ordinal) const {
+	return documents_[ordinal];
+}
+
+vector<SegmentTermCount> IndexSegment::GetDocumentTerms(int ordinal) const {
+	return { document_terms_.begin() + document_term_offsets_[ordinal], document_terms_.begin() + document_term_offsets_[ordinal + 1] };
+}
+
+int IndexSegment::FindOrdinal(int document_id) const {
+	const auto it = ordinals_.find(document_id);
+	return it == ordinals_.end() || IsDeleted(it->second) ? -1 : it->second;
+}
+
+bool IndexSegment::IsDeleted(int ordinal) const {
+	return (tombstones_[ordinal / 64].load(memory_order_relaxed) >> (ordinal % 64)) & 1;
+}
+
+void IndexSegment::Delete(int ordinal) {
+	const uint64_t bit = uint64_t{ 1 } << (ordinal % 64);
+	if ((tombstones_[ordinal / 64].fetch_or(bit, memory_order_relaxed) & bit) == 0) {
+		++deleted_count_;
+	}
+}
+
+size_t IndexSegment::GetMemoryUsage() const {
+	size_t bytes = sizeof(*this) + documents_.capacity() * sizeof(SegmentDocument)
+		+ document_term_offsets_.capacity() * sizeof(uint32_t) + document_terms_.capacity() * sizeof(SegmentTermCount)
+		+ term_ids_.capacity() * sizeof(TermId) + (documents_.size() + 63) / 64 * sizeof(uint64_t)
+		+ ordinals_.size() * (sizeof(pair<const int, int>) + sizeof(void*)) + ordinals_.bucket_count() * sizeof(void*);
+	for (const CompressedPostingList& postings : postings_) {
+		bytes += postings.GetMemoryUsage();
+	}
+	return bytes;
+}
+
+int MemorySegment::Add(const SegmentDocument& document, vector<SegmentTermCount> terms) {
+	const int ordinal = static_cast<int>(documents_.size());
+	for (const SegmentTermCount& term : terms) {
+		postings_[term.term_id].push_back({ ordinal, term.count });
+	}
+	documents_.push_back(document);
+	document_terms_.push_back(move(terms));
+	ordinals_[document.id] = ordinal;
+	deleted_.push_back(false);
+	return ordinal;
+}
+
+size_t MemorySegment::GetDocumentCount() const {
+	return documents_.size();
+}
+
+size_t MemorySegment::GetLiveDocumentCount() const {
+	return documents_.size() - deleted_count_;
+}
+
+const SegmentDocument& MemorySegment::GetDocument(int ordinal) const {
+	return documents_[ordinal];
+}
+
+const vector<SegmentTermCount>& MemorySegment::GetDocumentTerms(int ordinal) const {
+	return document_terms_[ordinal];
+}
+
+int MemorySegment::FindOrdinal(int document_id) const {
+	const auto it = ordinals_.find(document_id);
+	return it == ordinals_.end() || deleted_[it->second] ? -1 : it->second;
+}
+
+bool MemorySegment::IsDeleted(int ordinal) const {
+	return deleted_[ordinal];
+}
+
+void MemorySegment::Delete(int ordinal) {
+	if (!deleted_[ordinal]) {
+		deleted_[ordinal] = true;
+		++deleted_count_;
+	}
+}
+
+IndexSegment MemorySegment::Seal() const {
+	return IndexSegment(documents_, document_terms_);
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "compressed_postings.h"
+#include "document.h"
+#include "term_dictionary.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct SegmentDocument {
+	int id;
+	int rating;
+	DocumentStatus status;
+	int word_count;
+};
+
+struct SegmentTermCount {
+	TermDictionary::TermId term_id;
+	uint32_t count;
+};
+
+// Sealed part of a segmented index. Documents are numbered by a segment-local ordinal and
+// posting lists of global term ids are block-compressed. Only the tombstones change after
+// sealing; their words are atomic, so a segment can be merged while documents are being deleted from it.
+class IndexSegment {
+public:
+	using TermId = TermDictionary::TermId;
+
+	// Terms of every document are distinct and sorted by term id. Of the documents with the same id,
+	// only the last one can be live, so the id maps to it.
+	IndexSegment(std::vector<SegmentDocument> documents, const std::vector<std::vector<SegmentTermCount>>& document_terms);
+
+	// Merges the documents that are not deleted yet; new_ordinals maps the ordinals of
+	// every source segment to the merged one, or to -1 for a dropped document.
+	static IndexSegment Merge(const std::vector<const IndexSegment*>& segments, std::vector<std::vector<int>>& new_ordinals);
+
+	size_t GetDocumentCount() const;
+	size_t GetLiveDocumentCount() const;
+	const SegmentDocument& GetDocument(int ordinal) const;
+	std::vector<SegmentTermCount> GetDocumentTerms(int ordinal) const;
+	// Returns -1 unless a live document has the id.
+	int FindOrdinal(int document_id) const;
+
+	bool IsDeleted(int ordinal) const;
+	void Delete(int ordinal);
+
+	template <typename Function>
+	void ForEachPosting(TermId term_id, Function function) const;
+
+	size_t GetMemoryUsage() const;
+
+private:
+	std::vector<SegmentDocument> documents_;
+	std::unordered_map<int, int> ordinals_;
+	std::vector<uint32_t> document_term_offsets_;
+	std::vector<SegmentTermCount> document_terms_;
+	// Sorted term ids and their posting lists.
+	std::vector<TermId> term_ids_;
+	std::vector<CompressedPostingList> postings_;
+	std::unique_ptr<std::atomic<uint64_t>[]> tombstones_;
+	size_t deleted_count_ = 0;
+};
+
+// Mutable segment that receives new documents until it is sealed.
+class MemorySegment {
+public:
+	using TermId = TermDictionary::TermId;
+
+	int Add(const SegmentDocument& document, std::vector<SegmentTermCount> terms);
+
+	size_t GetDocumentCount() const;
+	size_t GetLiveDocumentCount() const;
+	const SegmentDocument& GetDocument(int ordinal) const;
+	const std::vector<SegmentTermCount>& GetDocumentTerms(int ordinal) const;
+	int FindOrdinal(int document_id) const;
+
+	bool IsDeleted(int ordinal) const;
+	void Delete(int ordinal);
+
+	template <typename Function>
+	void ForEachPosting(TermId term_id, Function function) const;
+
+	// Builds a sealed segment of every document, deleted ones included, under the same ordinals, so that
+	// the tombstones, which may change while it runs, can be copied over afterwards.
+	IndexSegment Seal() const;
+
+private:
+	std::vector<SegmentDocument> documents_;
+	std::vector<std::vector<SegmentTermCount>> document_terms_;
+	std::unordered_map<int, int> ordinals_;
+	std::unordered_map<TermId, std::vector<std::pair<int, uint32_t>>> postings_;
+	std::vector<bool> deleted_;
+	size_t deleted_count_ = 0;
+};
+
+template <typename Function>
+void IndexSegment::ForEachPosting(TermId term_id, Function function) const {
+	const auto it = std::lower_bound(term_ids_.begin(), term_ids_.end(), term_id);
+	if (it == term_ids_.end() || *it != term_id) {
+		return;
+	}
+	for (CompressedPostingList::Cursor cursor(postings_[it - term_ids_.begin()]); !cursor.IsEnd(); cursor.Next()) {
+		function(cursor.GetDocumentId(), cursor.GetCount());
+	}
+}
+
+template <typename Function>
+void MemorySegment::ForEachPosting(TermId term_id, Function function) const {
+	const auto it = postings_.find(term_id);
+	if (it == postings_.end()) {
+		return;
+	}
+	for (const auto& [ordinal, count] : it->second) {
+		function(ordinal, count);
+	}
+}
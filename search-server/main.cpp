@@ -43,11 +43,26 @@
 //}
 
 #include "search_server.h"
+#include "concurrent_search_server.h"
+#include "segmented_search_server.h"
+#include "remove_duplicates.h"
+#include "process_queries.h"
+#include "query_cache.h"
+#include "query_executor.h"
+#include "posting_index.h"
+#include "prefix_term_index.h"
+#include "compressed_postings.h"
 #include "log_duration.h"
+#include "string_processing.h"
+#include <chrono>
+#include <cstdio>
 #include <execution>
 #include <iostream>
+#include <atomic>
+#include <map>
 #include <random>
 #include <string>
+#include <thread>
 #include <vector>
 using namespace std;
 string GenerateWord(mt19937& generator, int max_length) {
@@ -91,27 +106,661 @@ vector<string> GenerateQueries(mt19937& generator, const vector<string>& diction
     }
     return queries;
 }
-template <typename ExecutionPolicy>
+template <typename Scoring = scoring::TfIdf, typename ExecutionPolicy>
 void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
     LOG_DURATION(mark);
     double total_relevance = 0;
     for (const string_view query : queries) {
-        for (const auto& document : search_server.FindTopDocuments(policy, query)) {
+        for (const auto& document : search_server.FindTopDocuments<Scoring>(policy, query)) {
             total_relevance += document.relevance;
         }
     }
     cout << total_relevance << endl;
 }
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
+
+template <typename Index, typename PostingWalker>
+void WalkPostings(string_view mark, const Index& index, const vector<string>& queries, PostingWalker walker) {
+    LOG_DURATION(mark);
+    double total_freq = 0;
+    for (const string_view query : queries) {
+        for (const string_view word : SplitIntoWords(query)) {
+            total_freq += walker(index, word);
+        }
+    }
+    cout << total_freq << endl;
+}
+
+void BenchmarkPostingLayouts(const vector<string>& documents, const vector<string>& queries) {
+    map<string_view, map<int, double>> tree_index;
+    PostingIndex posting_index;
+    vector<int> document_lengths;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const auto words = SplitIntoWords(documents[i]);
+        document_lengths.push_back(words.size());
+        map<string_view, double> word_freqs;
+        for (const string_view word : words) {
+            word_freqs[word] += 1.0 / words.size();
+        }
+        for (const auto [word, term_freq] : word_freqs) {
+            tree_index[word][i] = term_freq;
+            posting_index.AddPosting(word, i, term_freq);
+        }
+    }
+
+    WalkPostings("map of maps"sv, tree_index, queries, [](const auto& index, string_view word) {
+        double sum = 0;
+        if (const auto it = index.find(word); it != index.end()) {
+            for (const auto [document_id, term_freq] : it->second) {
+                sum += term_freq;
+            }
+        }
+        return sum;
+    });
+    WalkPostings("posting lists"sv, posting_index, queries, [](const auto& index, string_view word) {
+        double sum = 0;
+        if (const PostingList* postings = index.Find(word)) {
+            for (const double term_freq : postings->term_freqs) {
+                sum += term_freq;
+            }
+        }
+        return sum;
+    });
+
+    map<string_view, CompressedPostingList> compressed_index;
+    size_t posting_count = 0;
+    size_t posting_list_bytes = 0;
+    size_t compressed_bytes = 0;
+    for (const auto& [word, tree_postings] : tree_index) {
+        const PostingList& postings = *posting_index.Find(word);
+        vector<uint32_t> counts;
+        for (size_t i = 0; i < postings.Size(); ++i) {
+            counts.push_back(lround(postings.term_freqs[i] * document_lengths[postings.document_ids[i]]));
+        }
+        const auto& compressed = compressed_index[word] = CompressedPostingList(postings.document_ids, counts);
+        posting_count += postings.Size();
+        posting_list_bytes += postings.GetMemoryUsage();
+        compressed_bytes += compressed.GetMemoryUsage();
+    }
+    WalkPostings("compressed posting lists"sv, compressed_index, queries, [&](const auto& index, string_view word) {
+        double sum = 0;
+        if (const auto it = index.find(word); it != index.end()) {
+            for (CompressedPostingList::Cursor cursor(it->second); !cursor.IsEnd(); cursor.Next()) {
+                sum += cursor.GetCount() * 1.0 / document_lengths[cursor.GetDocumentId()];
+            }
+        }
+        return sum;
+    });
+
+    const size_t tree_node_bytes = 4 * sizeof(void*) + sizeof(pair<const int, double>);
+    cout << "postings: "sv << posting_count << endl;
+    cout << "map of maps (estimated): "sv << posting_count * tree_node_bytes << " bytes"sv << endl;
+    cout << "posting lists: "sv << posting_list_bytes << " bytes"sv << endl;
+    cout << "compressed posting lists: "sv << compressed_bytes << " bytes"sv << endl;
+}
+
+template <typename Loader>
+void BenchmarkIngestion(string_view mark, const string& stop_words, size_t document_count, Loader loader) {
+    SearchServer search_server(stop_words);
+    const auto start = chrono::steady_clock::now();
+    loader(search_server);
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cout << mark << ": "sv << static_cast<long long>(document_count / elapsed.count()) << " documents/sec"sv << endl;
+}
+
+void BenchmarkIngestion(const string& stop_words, const vector<string>& documents) {
+    BenchmarkIngestion("AddDocument loop"sv, stop_words, documents.size(), [&](SearchServer& search_server) {
+        search_server.SetIdfUpdatePolicy(IdfUpdatePolicy::DEFERRED);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+        search_server.SetIdfUpdatePolicy(IdfUpdatePolicy::EAGER);
+    });
+    vector<NewDocument> batch;
+    batch.reserve(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        batch.push_back({ static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 } });
+    }
+    BenchmarkIngestion("AddDocuments"sv, stop_words, documents.size(), [&](SearchServer& search_server) {
+        search_server.AddDocuments(batch);
+    });
+}
+
+// Runs queries from several threads for a second, optionally while another thread keeps adding and removing documents.
+void BenchmarkConcurrentServing(const string& stop_words, const vector<string>& documents, const vector<string>& queries) {
+    ConcurrentSearchServer search_server(stop_words);
+    const size_t initial_count = documents.size() / 2;
+    vector<NewDocument> batch;
+    for (size_t i = 0; i < initial_count; ++i) {
+        batch.push_back({ static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 } });
+    }
+    search_server.AddDocuments(batch);
+
+    auto serve = [&](string_view mark, bool with_updates) {
+        atomic<bool> stop = false;
+        atomic<size_t> query_count = 0;
+        size_t update_count = 0;
+        vector<thread> readers;
+        for (unsigned i = 0; i < max(2u, thread::hardware_concurrency()); ++i) {
+            readers.emplace_back([&, i] {
+                for (size_t query = i; !stop; query += 7) {
+                    search_server.FindTopDocuments(queries[query % queries.size()]);
+                    ++query_count;
+                }
+            });
+        }
+        thread writer([&] {
+            for (size_t i = initial_count; with_updates && !stop && i < documents.size(); ++i) {
+                search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+                search_server.RemoveDocument(i - initial_count);
+                update_count += 2;
+            }
+        });
+        this_thread::sleep_for(chrono::seconds(1));
+        stop = true;
+        writer.join();
+        for (thread& reader : readers) {
+            reader.join();
+        }
+        cout << mark << ": "sv << query_count << " queries/sec, "sv << update_count << " updates/sec"sv << endl;
+    };
+    serve("queries without updates"sv, false);
+    serve("queries with updates"sv, true);
+}
+
+void BenchmarkSegmentedIndex(const string& stop_words, const vector<string>& documents, const vector<string>& queries) {
+    SegmentedSearchServer search_server(stop_words);
+    chrono::duration<double, micro> slowest_add{};
+    {
+        LOG_DURATION("segmented ingest"sv);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            const auto start = chrono::steady_clock::now();
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+            slowest_add = max<chrono::duration<double, micro>>(slowest_add, chrono::steady_clock::now() - start);
+        }
+        search_server.Flush();
+    }
+    search_server.WaitForMerges();
+    cout << "slowest segmented add: "sv << static_cast<long long>(slowest_add.count()) << " mks, "sv
+        << search_server.GetSegmentCount() << " segments, "sv << search_server.GetMemoryUsage() << " bytes"sv << endl;
+    {
+        LOG_DURATION("segmented queries"sv);
+        double total_relevance = 0;
+        for (const string_view query : queries) {
+            for (const auto& document : search_server.FindTopDocuments(query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        cout << total_relevance << endl;
+    }
+}
+
+template <typename Remover>
+void BenchmarkRemoval(string_view mark, const string& stop_words, const vector<NewDocument>& batch, Remover remover) {
+    SearchServer search_server(stop_words);
+    search_server.AddDocuments(batch);
+    vector<int> document_ids;
+    for (size_t i = 0; i < batch.size(); i += 2) {
+        document_ids.push_back(batch[i].id);
+    }
+    LOG_DURATION(mark);
+    remover(search_server, document_ids);
+}
+
+void BenchmarkRemoval(const string& stop_words, const vector<string>& documents) {
+    vector<NewDocument> batch;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        batch.push_back({ static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 } });
+    }
+    BenchmarkRemoval("RemoveDocument loop"sv, stop_words, batch, [](SearchServer& search_server, const vector<int>& document_ids) {
+        for (const int document_id : document_ids) {
+            search_server.RemoveDocument(document_id);
+        }
+    });
+    BenchmarkRemoval("RemoveDocument(par) loop"sv, stop_words, batch, [](SearchServer& search_server, const vector<int>& document_ids) {
+        for (const int document_id : document_ids) {
+            search_server.RemoveDocument(execution::par, document_id);
+        }
+    });
+    BenchmarkRemoval("RemoveDocuments"sv, stop_words, batch, [](SearchServer& search_server, const vector<int>& document_ids) {
+        search_server.RemoveDocuments(document_ids);
+    });
+}
+
+// Every fourth document is an exact copy of an earlier one and every fourth a copy with one word replaced.
+void BenchmarkDuplicates(mt19937& generator, const vector<string>& dictionary, const vector<string>& documents) {
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        string document = documents[i];
+        if (i % 4 == 1) {
+            document = documents[i - 1];
+        }
+        else if (i % 4 == 2) {
+            document = documents[i - 2] + " "s + dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+            document.erase(0, document.find(' ') + 1);
+        }
+        search_server.AddDocument(i, document, DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+    const auto report = [](string_view mark, const DuplicateReport& report) {
+        cout << mark << ": "sv << report.duplicate_count << " of "sv << report.document_count << " documents, "sv
+            << report.false_candidate_count << " false candidates"sv << endl;
+    };
+    DuplicateReport exact_report;
+    {
+        LOG_DURATION("FindDuplicates"sv);
+        FindDuplicates(search_server, exact_report);
+    }
+    report("exact duplicates"sv, exact_report);
+    DuplicateReport near_report;
+    {
+        LOG_DURATION("FindNearDuplicates"sv);
+        FindNearDuplicates(search_server, 0.8, near_report);
+    }
+    report("near duplicates"sv, near_report);
+}
+
+template <typename Tokenizer>
+void BenchmarkTokenizer(string_view mark, const vector<string>& documents, Tokenizer tokenizer) {
+    size_t byte_count = 0;
+    size_t word_count = 0;
+    vector<string_view> words;
+    const auto start = chrono::steady_clock::now();
+    for (int pass = 0; pass < 10; ++pass) {
+        for (const string& document : documents) {
+            words.clear();
+            tokenizer(document, words);
+            byte_count += document.size();
+            word_count += words.size();
+        }
+    }
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cout << mark << ": "sv << static_cast<long long>(byte_count / elapsed.count() / 1'000'000) << " MB/sec, "sv << word_count << " words"sv << endl;
+}
+
+void BenchmarkTokenizer(const vector<string>& documents) {
+    // Splitting with find and validating every word afterwards, as the tokenizer did before.
+    BenchmarkTokenizer("find + validate"sv, documents, [](string_view str, vector<string_view>& words) {
+        while (true) {
+            const auto space = str.find(' ');
+            if (space != 0 && !str.empty()) {
+                words.push_back(str.substr(0, space));
+            }
+            if (space == str.npos) {
+                break;
+            }
+            str.remove_prefix(space + 1);
+        }
+        for (string_view word : words) {
+            if (any_of(word.begin(), word.end(), [](char c) { return c >= '\0' && c < ' '; })) {
+                return false;
+            }
+        }
+        return true;
+    });
+    BenchmarkTokenizer("SplitIntoWords"sv, documents, [](string_view str, vector<string_view>& words) {
+        SplitIntoWords(str, words);
+    });
+    BenchmarkTokenizer("SplitIntoValidWords"sv, documents, [](string_view str, vector<string_view>& words) {
+        return SplitIntoValidWords(str, words);
+    });
+}
+
+template <typename Searcher>
+void BenchmarkQueryLatency(string_view mark, const vector<string>& queries, Searcher searcher) {
+    vector<double> latencies;
+    latencies.reserve(queries.size() * 10);
+    for (int pass = 0; pass < 10; ++pass) {
+        for (const string& query : queries) {
+            const auto start = chrono::steady_clock::now();
+            searcher(query);
+            latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        }
+    }
+    sort(latencies.begin(), latencies.end());
+    cout << mark << ": p50 "sv << static_cast<long long>(latencies[latencies.size() / 2]) << " mks, p99 "sv
+        << static_cast<long long>(latencies[latencies.size() * 99 / 100]) << " mks"sv << endl;
+}
+
+void BenchmarkQueryLatency(const SearchServer& search_server, const vector<string>& queries) {
+    BenchmarkQueryLatency("new context per query"sv, queries, [&](const string& query) {
+        SearchServer::QueryContext context;
+        search_server.FindTopDocuments(context, query);
+    });
+    BenchmarkQueryLatency("thread context"sv, queries, [&](const string& query) {
+        search_server.FindTopDocuments(query);
+    });
+    SearchServer::QueryContext context;
+    BenchmarkQueryLatency("caller context"sv, queries, [&](const string& query) {
+        search_server.FindTopDocuments(context, query);
+    });
+    BenchmarkQueryLatency("caller context wand"sv, queries, [&](const string& query) {
+        search_server.FindTopDocuments(search_mode::wand, context, query);
+    });
+}
+
+// Zipf-distributed stream over a fixed set of distinct queries, served directly and through the cache.
+void BenchmarkQueryCache(mt19937& generator, const SearchServer& search_server, const vector<string>& distinct_queries) {
+    vector<double> weights(distinct_queries.size());
+    for (size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = 1.0 / (i + 1);
+    }
+    discrete_distribution<size_t> distribution(weights.begin(), weights.end());
+    vector<string> queries(20'000);
+    for (string& query : queries) {
+        query = distinct_queries[distribution(generator)];
+    }
+    {
+        LOG_DURATION("ProcessQueries without cache"sv);
+        ProcessQueries(search_server, queries);
+    }
+    QueryCache query_cache(search_server, 1024);
+    {
+        LOG_DURATION("ProcessQueries with cache"sv);
+        ProcessQueries(query_cache, queries);
+    }
+    const QueryCache::Statistics statistics = query_cache.GetStatistics();
+    cout << "query cache: "sv << statistics.hit_count << " hits, "sv << statistics.miss_count << " misses, "sv
+        << statistics.entry_count << " entries"sv << endl;
+}
+
+// Throughput on one large batch, then latency percentiles of small batches.
+template <typename BatchRunner>
+void BenchmarkBatches(string_view mark, const vector<string>& queries, BatchRunner runner) {
+    {
+        const auto start = chrono::steady_clock::now();
+        runner(queries);
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        cout << mark << ": "sv << static_cast<long long>(queries.size() / elapsed.count()) << " queries/sec"sv;
+    }
+    constexpr size_t batch_size = 32;
+    vector<double> latencies;
+    for (size_t first = 0; first + batch_size <= queries.size(); first += batch_size) {
+        const vector<string> batch(queries.begin() + first, queries.begin() + first + batch_size);
+        const auto start = chrono::steady_clock::now();
+        runner(batch);
+        latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+    }
+    sort(latencies.begin(), latencies.end());
+    cout << ", batch of "sv << batch_size << " p50 "sv << static_cast<long long>(latencies[latencies.size() / 2]) << " mks, p99 "sv
+        << static_cast<long long>(latencies[latencies.size() * 99 / 100]) << " mks"sv << endl;
+}
+
+void BenchmarkBatches(const SearchServer& search_server, const vector<string>& queries) {
+    BenchmarkBatches("ProcessQueries"sv, queries, [&](const vector<string>& batch) {
+        return ProcessQueries(search_server, batch);
+    });
+    BenchmarkBatches("ProcessQueriesJoined"sv, queries, [&](const vector<string>& batch) {
+        return ProcessQueriesJoined(search_server, batch);
+    });
+    QueryExecutor executor(search_server);
+    BenchmarkBatches("QueryExecutor"sv, queries, [&](const vector<string>& batch) {
+        return executor.Run(batch);
+    });
+}
+
+// Status queries compare the status tags of the postings; the same filter as a lambda goes through the documents.
+void BenchmarkStatusFilter(const string& stop_words, const vector<string>& documents, const vector<string>& queries) {
+    SearchServer search_server(stop_words);
+    vector<NewDocument> batch;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const DocumentStatus status = i % 5 < 3 ? DocumentStatus::ACTUAL : static_cast<DocumentStatus>(1 + i % 3);
+        batch.push_back({ static_cast<int>(i), documents[i], status, { 1, 2, 3 } });
+    }
+    search_server.AddDocuments(batch);
+    {
+        LOG_DURATION("status filter"sv);
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query, DocumentStatus::ACTUAL);
+        }
+    }
+    {
+        LOG_DURATION("predicate filter"sv);
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query, [](int document_id, DocumentStatus status, int rating) {
+                return status == DocumentStatus::ACTUAL;
+            });
+        }
+    }
+}
+
+void BenchmarkMinusWords(mt19937& generator, const SearchServer& search_server, const vector<string>& dictionary) {
+    vector<string> queries;
+    for (int i = 0; i < 1000; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, 12, 0.5));
+    }
+    Test("minus words seq"sv, search_server, queries, execution::seq);
+    Test("minus words wand"sv, search_server, queries, search_mode::wand);
+    Test("minus words partitioned"sv, search_server, queries, search_mode::partitioned);
+    LOG_DURATION("minus words MatchDocument"sv);
+    size_t matched_count = 0;
+    for (const int document_id : search_server) {
+        matched_count += get<0>(search_server.MatchDocument(queries[document_id % queries.size()], document_id)).size();
+    }
+    cout << matched_count << endl;
+}
+
+// Phrases of two or three consecutive words of random documents, against the same words without quotes.
+void BenchmarkPhrases(mt19937& generator, const string& stop_words, const vector<string>& documents) {
+    SearchServer search_server(stop_words);
+    search_server.EnablePositions();
+    vector<NewDocument> batch;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        batch.push_back({ static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 } });
+    }
+    {
+        LOG_DURATION("AddDocuments with positions"sv);
+        search_server.AddDocuments(batch);
+    }
+    const IndexMemoryUsage usage = search_server.GetIndexMemoryUsage();
+    cout << "positions: "sv << usage.position_bytes << " bytes, posting lists: "sv << usage.posting_list_bytes << " bytes"sv << endl;
+
+    vector<string> phrase_queries;
+    vector<string> word_queries;
+    for (int i = 0; i < 1000; ++i) {
+        const vector<string_view> words = SplitIntoWords(documents[uniform_int_distribution<size_t>(0, documents.size() - 1)(generator)]);
+        const size_t length = min<size_t>(words.size(), 2 + i % 2);
+        const size_t first = uniform_int_distribution<size_t>(0, words.size() - length)(generator);
+        string phrase;
+        for (size_t j = first; j < first + length; ++j) {
+            phrase.append(words[j]).push_back(' ');
+        }
+        phrase.pop_back();
+        word_queries.push_back(phrase);
+        phrase_queries.push_back("\""s + phrase + "\""s);
+    }
+    size_t match_count = 0;
+    for (const string& query : phrase_queries) {
+        match_count += search_server.FindTopDocuments(query).size();
+    }
+    cout << "phrase matches: "sv << match_count << endl;
+    BenchmarkQueryLatency("phrase queries"sv, phrase_queries, [&](const string& query) {
+        search_server.FindTopDocuments(query);
+    });
+    BenchmarkQueryLatency("phrase words"sv, word_queries, [&](const string& query) {
+        search_server.FindTopDocuments(query);
+    });
+}
+
+void BenchmarkScoring(const SearchServer& search_server, const vector<string>& long_queries, const vector<string>& short_queries) {
+    Test<scoring::Bm25>("bm25 seq"sv, search_server, long_queries, execution::seq);
+    Test<scoring::Bm25>("bm25 wand"sv, search_server, long_queries, search_mode::wand);
+    Test<scoring::Bm25>("bm25 partitioned"sv, search_server, long_queries, search_mode::partitioned);
+    Test<scoring::Bm25>("bm25 short queries seq"sv, search_server, short_queries, execution::seq);
+    Test<scoring::Bm25>("bm25 short queries wand"sv, search_server, short_queries, search_mode::wand);
+}
+
+// Words of natural text follow Zipf's law: a few are in most documents and most are rare. That is the text
+// the score bounds of WAND can prune, unlike the uniform documents above.
+void BenchmarkZipfText(mt19937& generator) {
+    const auto dictionary = GenerateDictionary(generator, 20'000, 12);
+    vector<double> weights;
+    for (size_t i = 0; i < dictionary.size(); ++i) {
+        weights.push_back(1.0 / (i + 1));
+    }
+    discrete_distribution<size_t> distribution(weights.begin(), weights.end());
+    const auto generate_text = [&](int word_count) {
+        string text;
+        for (int i = 0; i < word_count; ++i) {
+            if (i > 0) {
+                text += ' ';
+            }
+            text += dictionary[distribution(generator)];
+        }
+        return text;
+    };
+    SearchServer search_server(""s);
+    for (int i = 0; i < 20'000; ++i) {
+        search_server.AddDocument(i, generate_text(10 + i % 90), DocumentStatus::ACTUAL, { 1 });
+    }
+    vector<string> queries;
+    for (int i = 0; i < 1000; ++i) {
+        queries.push_back(generate_text(3));
+    }
+    Test("zipf text seq"sv, search_server, queries, execution::seq);
+    Test("zipf text wand"sv, search_server, queries, search_mode::wand);
+    Test<scoring::Bm25>("zipf text bm25 seq"sv, search_server, queries, execution::seq);
+    Test<scoring::Bm25>("zipf text bm25 wand"sv, search_server, queries, search_mode::wand);
+}
+
+void BenchmarkPrefixSearch(mt19937& generator) {
+    vector<string> dictionary;
+    TermDictionary terms;
+    while (terms.Size() < 1'000'000) {
+        string word = GenerateWord(generator, 8);
+        const size_t term_count = terms.Size();
+        terms.Intern(word);
+        if (terms.Size() > term_count) {
+            dictionary.push_back(move(word));
+        }
+    }
+    PrefixTermIndex prefix_index;
+    {
+        LOG_DURATION("prefix index build"sv);
+        // Terms arrive a few at a time, as they do with documents added one by one.
+        TermDictionary growing_terms;
+        for (size_t i = 0; i < dictionary.size(); ++i) {
+            growing_terms.Intern(dictionary[i]);
+            if (i % 8 == 7) {
+                prefix_index.Update(growing_terms);
+            }
+        }
+        prefix_index.Update(growing_terms);
+    }
+    map<string_view, TermDictionary::TermId> sorted_terms;
+    for (TermDictionary::TermId term_id = 0; term_id < terms.Size(); ++term_id) {
+        sorted_terms.emplace(terms.GetTerm(term_id), term_id);
+    }
+    cout << "prefix index: "sv << terms.Size() << " terms, "sv << prefix_index.GetMemoryUsage() << " bytes, term dictionary: "sv
+        << terms.GetMemoryUsage() << " bytes"sv << endl;
+
+    vector<string> prefixes;
+    for (int i = 0; i < 1000; ++i) {
+        const string& word = dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        prefixes.push_back(word.substr(0, 2 + i % 3));
+    }
+    vector<TermDictionary::TermId> term_ids;
+    size_t expansion_count = 0;
+    for (const string& prefix : prefixes) {
+        term_ids.clear();
+        prefix_index.FindTerms(prefix, term_ids);
+        expansion_count += term_ids.size();
+    }
+    cout << "terms per prefix: "sv << expansion_count / prefixes.size() << endl;
+    BenchmarkQueryLatency("prefix lookup front-coded"sv, prefixes, [&](const string& prefix) {
+        term_ids.clear();
+        prefix_index.FindTerms(prefix, term_ids);
+    });
+    BenchmarkQueryLatency("prefix lookup map"sv, prefixes, [&](const string& prefix) {
+        term_ids.clear();
+        for (auto it = sorted_terms.lower_bound(prefix); it != sorted_terms.end() && it->first.substr(0, prefix.size()) == prefix; ++it) {
+            term_ids.push_back(it->second);
+        }
+    });
+
+    // Every term of the dictionary is indexed, eight per document.
+    SearchServer search_server(""s);
+    vector<string> texts;
+    vector<NewDocument> batch;
+    for (size_t first = 0; first < dictionary.size(); first += 8) {
+        string text;
+        for (size_t i = first; i < min(first + 8, dictionary.size()); ++i) {
+            text.append(dictionary[i]).push_back(' ');
+        }
+        texts.push_back(move(text));
+    }
+    for (size_t i = 0; i < texts.size(); ++i) {
+        batch.push_back({ static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, { 1 } });
+    }
+    search_server.AddDocuments(batch);
+    vector<string> prefix_queries;
+    for (const string& prefix : prefixes) {
+        prefix_queries.push_back(prefix + "* "s + dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)]);
+    }
+    BenchmarkQueryLatency("prefix queries seq"sv, prefix_queries, [&](const string& query) {
+        search_server.FindTopDocuments(query);
+    });
+    BenchmarkQueryLatency("prefix queries wand"sv, prefix_queries, [&](const string& query) {
+        search_server.FindTopDocuments(search_mode::wand, query);
+    });
+}
+
 int main() {
     mt19937 generator;
     const auto dictionary = GenerateDictionary(generator, 1000, 10);
     const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
     SearchServer search_server(dictionary[0]);
-    for (size_t i = 0; i < documents.size(); ++i) {
-        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    {
+        LOG_DURATION("bulk load"sv);
+        search_server.SetIdfUpdatePolicy(IdfUpdatePolicy::DEFERRED);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+        search_server.SetIdfUpdatePolicy(IdfUpdatePolicy::EAGER);
     }
     const auto queries = GenerateQueries(generator, dictionary, 100, 70);
     TEST(seq);
     TEST(par);
+    Test("wand"sv, search_server, queries, search_mode::wand);
+    Test("partitioned"sv, search_server, queries, search_mode::partitioned);
+    {
+        const auto short_queries = GenerateQueries(generator, dictionary, 1000, 3);
+        Test("short queries seq"sv, search_server, short_queries, execution::seq);
+        Test("short queries wand"sv, search_server, short_queries, search_mode::wand);
+        Test("short queries partitioned"sv, search_server, short_queries, search_mode::partitioned);
+        BenchmarkQueryLatency(search_server, short_queries);
+        BenchmarkQueryCache(generator, search_server, short_queries);
+        BenchmarkBatches(search_server, short_queries);
+        BenchmarkStatusFilter(dictionary[0], documents, short_queries);
+        BenchmarkScoring(search_server, queries, short_queries);
+    }
+    BenchmarkZipfText(generator);
+    BenchmarkMinusWords(generator, search_server, dictionary);
+    BenchmarkPhrases(generator, dictionary[0], documents);
+    BenchmarkPrefixSearch(generator);
+    BenchmarkPostingLayouts(documents, queries);
+    BenchmarkTokenizer(documents);
+    BenchmarkIngestion(dictionary[0], documents);
+    {
+        const string snapshot_path = "search_server.snapshot"s;
+        {
+            LOG_DURATION("save snapshot"sv);
+            search_server.SaveSnapshot(snapshot_path);
+        }
+        const SearchServer loaded_server = [&] {
+            LOG_DURATION("load snapshot"sv);
+            return SearchServer::LoadSnapshot(snapshot_path);
+        }();
+        Test("seq from snapshot"sv, loaded_server, queries, execution::seq);
+        remove(snapshot_path.c_str());
+    }
+    BenchmarkConcurrentServing(dictionary[0], documents, queries);
+    BenchmarkSegmentedIndex(dictionary[0], documents, queries);
+    BenchmarkRemoval(dictionary[0], documents);
+    BenchmarkDuplicates(generator, dictionary, documents);
+    {
+        const IndexMemoryUsage usage = search_server.GetIndexMemoryUsage();
+        cout << "search server index: "sv << usage.term_count << " terms, "sv << usage.posting_count << " postings, "sv
+            << usage.posting_list_bytes << " bytes"sv << endl;
+        cout << "term dictionary: "sv << usage.term_dictionary_bytes << " bytes, document terms: "sv << usage.document_terms_bytes << " bytes"sv << endl;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "positional_index.h"
+#include <algorithm>
+#include <functional>
+using namespace std;
+
+namespace {
+
+void EncodeVarint(uint32_t value, vector<uint8_t>& out) {
+	while (value >= 0x80) {
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+} // namespace
+
+void PositionalIndex::Resize(size_t document_count) {
+	documents_.resize(document_count);
+}
+
+void PositionalIndex::SetDocument(int ordinal, const vector<pair<TermId, uint32_t>>& term_positions) {
+	DocumentPositions& document = documents_[ordinal];
+	document.term_ids.clear();
+	document.offsets.clear();
+	document.data.clear();
+	uint32_t previous_position = 0;
+	for (const auto& [term_id, position] : term_positions) {
+		if (document.term_ids.empty() || document.term_ids.back() != term_id) {
+			document.term_ids.push_back(term_id);
+			document.offsets.push_back(static_cast<uint32_t>(document.data.size()));
+			previous_position = 0;
+		}
+		EncodeVarint(position - previous_position, document.data);
+		previous_position = position;
+	}
+	if (!document.term_ids.empty()) {
+		document.offsets.push_back(static_cast<uint32_t>(document.data.size()));
+	}
+	document.term_ids.shrink_to_fit();
+	document.offsets.shrink_to_fit();
+	document.data.shrink_to_fit();
+}
+
+void PositionalIndex::ClearDocument(int ordinal) {
+	documents_[ordinal] = {};
+}
+
+bool PositionalIndex::GetPositions(int ordinal, TermId term_id, vector<uint32_t>& positions) const {
+	positions.clear();
+	const DocumentPositions& document = documents_[ordinal];
+	const auto it = lower_bound(document.term_ids.begin(), document.term_ids.end(), term_id);
+	if (it == document.term_ids.end() || *it != term_id) {
+		return false;
+	}
+	const size_t index = it - document.term_ids.begin();
+	const uint8_t* in = document.data.data() + document.offsets[index];
+	const uint8_t* const end = document.data.data() + document.offsets[index + 1];
+	uint32_t position = 0;
+	while (in != end) {
+		uint32_t delta = 0;
+		for (int shift = 0; in != end; shift += 7) {
+			const uint8_t byte = *in++;
+			delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) {
+				break;
+			}
+		}
+		position += delta;
+		positions.push_back(position);
+	}
+	return true;
+}
+
+size_t PositionalIndex::GetMemoryUsage() const {
+	size_t usage = documents_.capacity() * sizeof(DocumentPositions);
+	for (const DocumentPositions& document : documents_) {
+		usage += document.term_ids.capacity() * sizeof(TermId) + document.offsets.capacity() * sizeof(uint32_t) + document.data.capacity();
+	}
+	return usage;
+}
+
+void PositionalIndex::Save(SnapshotWriter& writer, const vector<bool>& skipped) const {
+	writer.Write<uint64_t>(documents_.size());
+	for (size_t ordinal = 0; ordinal < documents_.size(); ++ordinal) {
+		const DocumentPositions& document = documents_[ordinal];
+		const bool is_skipped = skipped[ordinal];
+		writer.WriteArray(document.term_ids.data(), is_skipped ? 0 : document.term_ids.size());
+		writer.WriteArray(document.offsets.data(), is_skipped ? 0 : document.offsets.size());
+		writer.WriteArray(document.data.data(), is_skipped ? 0 : document.data.size());
+	}
+}
+
+void PositionalIndex::Load(SnapshotReader& reader) {
+	documents_.resize(reader.Read<uint64_t>());
+	for (DocumentPositions& document : documents_) {
+		const auto [term_ids, term_count] = reader.ReadArray<TermId>();
+		const auto [offsets, offset_count] = reader.ReadArray<uint32_t>();
+		const auto [data, data_size] = reader.ReadArray<uint8_t>();
+		// Offsets are checked here, so that decoding stays within data.
+		if (offset_count != (term_count == 0 ? 0 : term_count + 1)
+			|| (offset_count > 0 && (offsets[0] != 0 || offsets[offset_count - 1] != data_size))
+			|| !is_sorted(offsets, offsets + offset_count)
+			|| adjacent_find(term_ids, term_ids + term_count, greater_equal<TermId>()) != term_ids + term_count) {
+			throw runtime_error("corrupted snapshot");
+		}
+		document.term_ids.assign(term_ids, term_ids + term_count);
+		document.offsets.assign(offsets, offsets + offset_count);
+		document.data.assign(data, data + data_size);
+	}
+}
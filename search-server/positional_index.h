@@ -0,0 +1,39 @@
+#pragma once
+#include "snapshot.h"
+#include "term_dictionary.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Positions of the words of every document, for phrase queries. The positions of one posting are
+// delta-encoded as varints; the postings of a document are stored together, ordered by term id.
+// Distinct documents can be set from different threads once the index is sized for them.
+class PositionalIndex {
+public:
+	using TermId = TermDictionary::TermId;
+
+	// Sizes the index for document_count ordinals; added ordinals have no positions.
+	void Resize(size_t document_count);
+	// term_positions holds a pair of a term id and a position for every word of the document, sorted.
+	void SetDocument(int ordinal, const std::vector<std::pair<TermId, uint32_t>>& term_positions);
+	void ClearDocument(int ordinal);
+
+	// Decodes the sorted positions of the term in the document; false if the document does not contain the term.
+	bool GetPositions(int ordinal, TermId term_id, std::vector<uint32_t>& positions) const;
+
+	size_t GetMemoryUsage() const;
+
+	// Documents whose ordinals are marked as skipped are saved without positions.
+	void Save(SnapshotWriter& writer, const std::vector<bool>& skipped) const;
+	void Load(SnapshotReader& reader);
+
+private:
+	struct DocumentPositions {
+		std::vector<TermId> term_ids;
+		// Where the positions of every term start in data, followed by the size of data.
+		std::vector<uint32_t> offsets;
+		std::vector<uint8_t> data;
+	};
+
+	std::vector<DocumentPositions> documents_;
+};
@@ -0,0 +1,248 @@
+#include "posting_index.h"
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+size_t PostingList::Size() const {
+	return document_ids.size();
+}
+
+bool PostingList::Empty() const {
+	return document_ids.empty();
+}
+
+size_t PostingList::GetDocumentFreq() const {
+	return document_ids.size() - deleted_count;
+}
+
+bool PostingList::Contains(int document_id) const {
+	return documents.Contains(static_cast<uint32_t>(document_id));
+}
+
+size_t PostingList::Seek(size_t from, int document_id) const {
+	size_t step = 1;
+	while (from + step < document_ids.size() && document_ids[from + step] < document_id) {
+		step *= 2;
+	}
+	const auto first = document_ids.begin() + min(from + step / 2, document_ids.size());
+	const auto last = document_ids.begin() + min(from + step + 1, document_ids.size());
+	return lower_bound(first, last, document_id) - document_ids.begin();
+}
+
+void PostingList::Insert(int document_id, double term_freq, uint8_t tag) {
+	if (document_ids.empty() || document_ids.back() < document_id) {
+		document_ids.push_back(document_id);
+		term_freqs.push_back(term_freq);
+		tags.push_back(tag);
+		documents.Add(static_cast<uint32_t>(document_id));
+		max_term_freq = max(max_term_freq, term_freq);
+		return;
+	}
+	auto it = lower_bound(document_ids.begin(), document_ids.end(), document_id);
+	const auto pos = it - document_ids.begin();
+	if (*it == document_id) {
+		term_freqs[pos] += term_freq;
+		max_term_freq = max(max_term_freq, term_freqs[pos]);
+		return;
+	}
+	document_ids.insert(it, document_id);
+	term_freqs.insert(term_freqs.begin() + pos, term_freq);
+	tags.insert(tags.begin() + pos, tag);
+	documents.Add(static_cast<uint32_t>(document_id));
+	max_term_freq = max(max_term_freq, term_freq);
+}
+
+bool PostingList::Erase(int document_id) {
+	auto it = lower_bound(document_ids.begin(), document_ids.end(), document_id);
+	if (it == document_ids.end() || *it != document_id) {
+		return false;
+	}
+	const auto pos = it - document_ids.begin();
+	const double erased_freq = term_freqs[pos];
+	term_freqs.erase(term_freqs.begin() + pos);
+	tags.erase(tags.begin() + pos);
+	document_ids.erase(it);
+	documents.Remove(static_cast<uint32_t>(document_id));
+	if (erased_freq >= max_term_freq) {
+		max_term_freq = term_freqs.empty() ? 0 : *max_element(term_freqs.begin(), term_freqs.end());
+	}
+	return true;
+}
+
+void PostingList::Merge(const vector<Posting>& postings) {
+	if (postings.empty()) {
+		return;
+	}
+	for (const Posting& posting : postings) {
+		max_term_freq = max(max_term_freq, posting.term_freq);
+		documents.Add(static_cast<uint32_t>(posting.document_id));
+	}
+	if (document_ids.empty() || document_ids.back() < postings.front().document_id) {
+		document_ids.reserve(document_ids.size() + postings.size());
+		term_freqs.reserve(term_freqs.size() + postings.size());
+		tags.reserve(tags.size() + postings.size());
+		for (const Posting& posting : postings) {
+			document_ids.push_back(posting.document_id);
+			term_freqs.push_back(posting.term_freq);
+			tags.push_back(posting.tag);
+		}
+		return;
+	}
+
+	vector<int> merged_ids;
+	vector<double> merged_freqs;
+	vector<uint8_t> merged_tags;
+	merged_ids.reserve(document_ids.size() + postings.size());
+	merged_freqs.reserve(document_ids.size() + postings.size());
+	merged_tags.reserve(document_ids.size() + postings.size());
+	size_t i = 0;
+	for (const Posting& posting : postings) {
+		for (; i < document_ids.size() && document_ids[i] < posting.document_id; ++i) {
+			merged_ids.push_back(document_ids[i]);
+			merged_freqs.push_back(term_freqs[i]);
+			merged_tags.push_back(tags[i]);
+		}
+		merged_ids.push_back(posting.document_id);
+		merged_freqs.push_back(posting.term_freq);
+		merged_tags.push_back(posting.tag);
+	}
+	merged_ids.insert(merged_ids.end(), document_ids.begin() + i, document_ids.end());
+	merged_freqs.insert(merged_freqs.end(), term_freqs.begin() + i, term_freqs.end());
+	merged_tags.insert(merged_tags.end(), tags.begin() + i, tags.end());
+	document_ids = move(merged_ids);
+	term_freqs = move(merged_freqs);
+	tags = move(merged_tags);
+}
+
+void PostingList::EraseDeleted(const vector<bool>& tombstones) {
+	size_t kept = 0;
+	max_term_freq = 0;
+	for (size_t i = 0; i < document_ids.size(); ++i) {
+		if (!tombstones[document_ids[i]]) {
+			document_ids[kept] = document_ids[i];
+			term_freqs[kept] = term_freqs[i];
+			tags[kept] = tags[i];
+			max_term_freq = max(max_term_freq, term_freqs[i]);
+			++kept;
+		}
+	}
+	document_ids.resize(kept);
+	term_freqs.resize(kept);
+	tags.resize(kept);
+	deleted_count = 0;
+	RebuildDocuments();
+}
+
+void PostingList::RebuildDocuments() {
+	documents.Clear();
+	for (const int document_id : document_ids) {
+		documents.Add(static_cast<uint32_t>(document_id));
+	}
+}
+
+size_t PostingList::GetMemoryUsage() const {
+	return sizeof(*this) + document_ids.capacity() * sizeof(int) + term_freqs.capacity() * sizeof(double) + tags.capacity() + documents.GetMemoryUsage();
+}
+
+PostingIndex::TermId PostingIndex::AddPosting(string_view term, int document_id, double term_freq, uint8_t tag) {
+	const TermId term_id = AddTerm(term);
+	PostingList& postings = postings_[term_id];
+	postings.Insert(document_id, term_freq, tag);
+	UpdateDocumentFreq(postings);
+	return term_id;
+}
+
+void PostingIndex::RemovePosting(TermId term_id, int document_id) {
+	PostingList& postings = postings_[term_id];
+	if (postings.Erase(document_id)) {
+		UpdateDocumentFreq(postings);
+	}
+}
+
+PostingIndex::TermId PostingIndex::AddTerm(string_view term) {
+	const TermId term_id = terms_.Intern(term);
+	if (term_id == postings_.size()) {
+		postings_.emplace_back();
+	}
+	return term_id;
+}
+
+PostingIndex::TermId PostingIndex::AddExternalTerm(string_view term) {
+	const TermId term_id = terms_.InternExternal(term);
+	if (term_id == postings_.size()) {
+		postings_.emplace_back();
+	}
+	return term_id;
+}
+
+void PostingIndex::SetPostings(TermId term_id, PostingList postings) {
+	postings_[term_id] = move(postings);
+	postings_[term_id].RebuildDocuments();
+	UpdateDocumentFreq(postings_[term_id]);
+}
+
+void PostingIndex::MergePostings(TermId term_id, const vector<Posting>& postings) {
+	PostingList& term_postings = postings_[term_id];
+	term_postings.Merge(postings);
+	UpdateDocumentFreq(term_postings);
+}
+
+const PostingList* PostingIndex::Find(string_view term) const {
+	const TermId term_id = terms_.Find(term);
+	if (term_id == TermDictionary::NO_TERM) {
+		return nullptr;
+	}
+	return &postings_[term_id];
+}
+
+PostingIndex::TermId PostingIndex::FindTermId(string_view term) const {
+	return terms_.Find(term);
+}
+
+const PostingList& PostingIndex::GetPostings(TermId term_id) const {
+	return postings_[term_id];
+}
+
+string_view PostingIndex::GetTerm(TermId term_id) const {
+	return terms_.GetTerm(term_id);
+}
+
+size_t PostingIndex::GetTermCount() const {
+	return terms_.Size();
+}
+
+const vector<PostingList>& PostingIndex::GetPostingLists() const {
+	return postings_;
+}
+
+const TermDictionary& PostingIndex::GetTermDictionary() const {
+	return terms_;
+}
+
+void PostingIndex::SetDeferredDocumentFreqs(bool deferred) {
+	deferred_document_freqs_ = deferred;
+}
+
+void PostingIndex::RecomputeDocumentFreqs() {
+	for (PostingList& postings : postings_) {
+		postings.log_document_freq = log(postings.GetDocumentFreq());
+	}
+}
+
+void PostingIndex::MarkDeleted(TermId term_id, size_t deleted_count) {
+	PostingList& postings = postings_[term_id];
+	postings.deleted_count += deleted_count;
+	UpdateDocumentFreq(postings);
+}
+
+void PostingIndex::PurgeDeleted(TermId term_id, const vector<bool>& tombstones) {
+	PostingList& postings = postings_[term_id];
+	postings.EraseDeleted(tombstones);
+	UpdateDocumentFreq(postings);
+}
+
+void PostingIndex::UpdateDocumentFreq(PostingList& postings) const {
+	if (!deferred_document_freqs_) {
+		postings.log_document_freq = log(postings.GetDocumentFreq());
+	}
+}
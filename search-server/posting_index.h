@@ -0,0 +1,88 @@
+#pragma once
+#include "document_bitmap.h"
+#include "term_dictionary.h"
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct Posting {
+	int document_id;
+	double term_freq;
+	uint8_t tag;
+};
+
+// Postings of one term stored as parallel arrays sorted by document id.
+struct PostingList {
+	std::vector<int> document_ids;
+	std::vector<double> term_freqs;
+	// Caller-defined byte of every posting; the search server keeps the document status there,
+	// so that status filters do not have to look up the documents.
+	std::vector<uint8_t> tags;
+	// Same document ids as a bitmap, for membership tests and set operations between terms.
+	DocumentBitmap documents;
+	double max_term_freq = 0;
+	// Logarithm of the document frequency, so that IDF is a subtraction at query time.
+	double log_document_freq = 0;
+	// Postings of tombstoned documents that are still in the arrays; they do not count towards the document frequency.
+	size_t deleted_count = 0;
+
+	size_t Size() const;
+	bool Empty() const;
+	size_t GetDocumentFreq() const;
+	bool Contains(int document_id) const;
+	// Position of the first posting at or after from whose document id is not less than document_id.
+	size_t Seek(size_t from, int document_id) const;
+	void Insert(int document_id, double term_freq, uint8_t tag);
+	bool Erase(int document_id);
+	// Adds postings sorted by document id for documents that are not in the list yet.
+	void Merge(const std::vector<Posting>& postings);
+	void EraseDeleted(const std::vector<bool>& tombstones);
+	// Rebuilds documents after document_ids were filled directly.
+	void RebuildDocuments();
+
+	size_t GetMemoryUsage() const;
+};
+
+class PostingIndex {
+public:
+	using TermId = TermDictionary::TermId;
+
+	TermId AddPosting(std::string_view term, int document_id, double term_freq, uint8_t tag = 0);
+	void RemovePosting(TermId term_id, int document_id);
+
+	// Interns the term with a possibly empty posting list, so that postings of distinct
+	// terms can then be merged from different threads.
+	TermId AddTerm(std::string_view term);
+	void MergePostings(TermId term_id, const std::vector<Posting>& postings);
+
+	// Restores an index from a snapshot: terms are not copied and must outlive the index.
+	TermId AddExternalTerm(std::string_view term);
+	void SetPostings(TermId term_id, PostingList postings);
+
+	// Tombstoned postings stay in place until PurgeDeleted; only the document frequency changes.
+	// Distinct terms can be updated from different threads.
+	void MarkDeleted(TermId term_id, size_t deleted_count);
+	void PurgeDeleted(TermId term_id, const std::vector<bool>& tombstones);
+
+	const PostingList* Find(std::string_view term) const;
+	TermId FindTermId(std::string_view term) const;
+	const PostingList& GetPostings(TermId term_id) const;
+	std::string_view GetTerm(TermId term_id) const;
+
+	size_t GetTermCount() const;
+	const std::vector<PostingList>& GetPostingLists() const;
+	const TermDictionary& GetTermDictionary() const;
+
+	// While deferred, postings changes leave log_document_freq stale until RecomputeDocumentFreqs.
+	void SetDeferredDocumentFreqs(bool deferred);
+	void RecomputeDocumentFreqs();
+
+private:
+	bool deferred_document_freqs_ = false;
+
+	TermDictionary terms_;
+	std::vector<PostingList> postings_;
+
+	void UpdateDocumentFreq(PostingList& postings) const;
+};
@@ -0,0 +1,203 @@
+#include "prefix_term_index.h"
+#include <algorithm>
+using namespace std;
+
+namespace {
+
+void EncodeVarint(uint32_t value, vector<uint8_t>& out) {
+	while (value >= 0x80) {
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t DecodeVarint(const vector<uint8_t>& data, size_t& offset) {
+	uint32_t value = 0;
+	for (int shift = 0;; shift += 7) {
+		const uint8_t byte = data[offset++];
+		value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if (byte < 0x80) {
+			return value;
+		}
+	}
+}
+
+bool StartsWith(string_view term, string_view prefix) {
+	return term.substr(0, prefix.size()) == prefix;
+}
+
+} // namespace
+
+// Decodes terms one after another from the start of a block to the end of the data.
+class FrontCodedTerms::Reader {
+public:
+	Reader(const FrontCodedTerms& terms, size_t offset)
+		: data_(terms.data_)
+		, offset_(offset) {
+	}
+
+	bool Next() {
+		if (offset_ == data_.size()) {
+			return false;
+		}
+		const uint32_t shared_size = DecodeVarint(data_, offset_);
+		const uint32_t suffix_size = DecodeVarint(data_, offset_);
+		term_.resize(shared_size);
+		term_.append(reinterpret_cast<const char*>(data_.data() + offset_), suffix_size);
+		offset_ += suffix_size;
+		term_id_ = DecodeVarint(data_, offset_);
+		return true;
+	}
+
+	string_view GetTerm() const {
+		return term_;
+	}
+
+	TermId GetTermId() const {
+		return term_id_;
+	}
+
+private:
+	const vector<uint8_t>& data_;
+	size_t offset_;
+	string term_;
+	TermId term_id_ = 0;
+};
+
+void FrontCodedTerms::Append(string_view term, TermId term_id) {
+	size_t shared_size = 0;
+	if (size_ % BLOCK_SIZE == 0) {
+		block_offsets_.push_back(static_cast<uint32_t>(data_.size()));
+	}
+	else {
+		const size_t max_shared_size = min(term.size(), last_term_.size());
+		while (shared_size < max_shared_size && term[shared_size] == last_term_[shared_size]) {
+			++shared_size;
+		}
+	}
+	EncodeVarint(static_cast<uint32_t>(shared_size), data_);
+	EncodeVarint(static_cast<uint32_t>(term.size() - shared_size), data_);
+	data_.insert(data_.end(), term.begin() + shared_size, term.end());
+	EncodeVarint(term_id, data_);
+	last_term_.assign(term);
+	++size_;
+}
+
+FrontCodedTerms FrontCodedTerms::Merge(const FrontCodedTerms& lhs, const FrontCodedTerms& rhs) {
+	FrontCodedTerms merged;
+	merged.data_.reserve(lhs.data_.size() + rhs.data_.size());
+	Reader lhs_reader(lhs, 0);
+	Reader rhs_reader(rhs, 0);
+	bool has_lhs = lhs_reader.Next();
+	bool has_rhs = rhs_reader.Next();
+	while (has_lhs || has_rhs) {
+		if (has_lhs && (!has_rhs || lhs_reader.GetTerm() < rhs_reader.GetTerm())) {
+			merged.Append(lhs_reader.GetTerm(), lhs_reader.GetTermId());
+			has_lhs = lhs_reader.Next();
+		}
+		else {
+			merged.Append(rhs_reader.GetTerm(), rhs_reader.GetTermId());
+			has_rhs = rhs_reader.Next();
+		}
+	}
+	return merged;
+}
+
+size_t FrontCodedTerms::Size() const {
+	return size_;
+}
+
+void FrontCodedTerms::FindPrefix(string_view prefix, vector<TermId>& term_ids) const {
+	if (size_ == 0) {
+		return;
+	}
+	// Terms with the prefix start in the last block whose first term is less than the prefix.
+	size_t first_block = 0;
+	size_t last_block = block_offsets_.size();
+	while (first_block < last_block) {
+		const size_t block = first_block + (last_block - first_block) / 2;
+		if (GetBlockFirstTerm(block) < prefix) {
+			first_block = block + 1;
+		}
+		else {
+			last_block = block;
+		}
+	}
+	Reader reader(*this, block_offsets_[first_block > 0 ? first_block - 1 : 0]);
+	while (reader.Next()) {
+		const string_view term = reader.GetTerm();
+		if (term < prefix) {
+			continue;
+		}
+		if (!StartsWith(term, prefix)) {
+			break;
+		}
+		term_ids.push_back(reader.GetTermId());
+	}
+}
+
+size_t FrontCodedTerms::GetMemoryUsage() const {
+	return data_.capacity() + block_offsets_.capacity() * sizeof(uint32_t) + last_term_.capacity();
+}
+
+string_view FrontCodedTerms::GetBlockFirstTerm(size_t block) const {
+	size_t offset = block_offsets_[block];
+	DecodeVarint(data_, offset);
+	const uint32_t size = DecodeVarint(data_, offset);
+	return { reinterpret_cast<const char*>(data_.data() + offset), size };
+}
+
+void PrefixTermIndex::Update(const TermDictionary& terms) {
+	const size_t first_new = buffer_.size();
+	for (size_t term_id = term_count_; term_id < terms.Size(); ++term_id) {
+		buffer_.emplace_back(terms.GetTerm(static_cast<TermId>(term_id)), static_cast<TermId>(term_id));
+	}
+	term_count_ = terms.Size();
+	if (buffer_.size() == first_new) {
+		return;
+	}
+	sort(buffer_.begin() + first_new, buffer_.end());
+	inplace_merge(buffer_.begin(), buffer_.begin() + first_new, buffer_.end());
+	if (buffer_.size() >= BUFFER_SIZE) {
+		FlushBuffer();
+	}
+}
+
+void PrefixTermIndex::FindTerms(string_view prefix, vector<TermId>& term_ids) const {
+	for (const FrontCodedTerms& run : runs_) {
+		run.FindPrefix(prefix, term_ids);
+	}
+	auto it = lower_bound(buffer_.begin(), buffer_.end(), prefix, [](const pair<string_view, TermId>& entry, string_view value) {
+		return entry.first < value;
+	});
+	for (; it != buffer_.end() && StartsWith(it->first, prefix); ++it) {
+		term_ids.push_back(it->second);
+	}
+}
+
+size_t PrefixTermIndex::GetMemoryUsage() const {
+	size_t bytes = buffer_.capacity() * sizeof(buffer_[0]) + runs_.capacity() * sizeof(FrontCodedTerms);
+	for (const FrontCodedTerms& run : runs_) {
+		bytes += run.GetMemoryUsage();
+	}
+	return bytes;
+}
+
+void PrefixTermIndex::FlushBuffer() {
+	FrontCodedTerms run;
+	for (const auto& [term, term_id] : buffer_) {
+		run.Append(term, term_id);
+	}
+	// A bulk update can leave a buffer far above its usual size.
+	if (buffer_.capacity() > 2 * BUFFER_SIZE) {
+		buffer_ = {};
+	}
+	buffer_.clear();
+	runs_.push_back(move(run));
+	while (runs_.size() > 1 && runs_[runs_.size() - 2].Size() < 2 * runs_.back().Size()) {
+		FrontCodedTerms merged = FrontCodedTerms::Merge(runs_[runs_.size() - 2], runs_.back());
+		runs_.pop_back();
+		runs_.back() = move(merged);
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "term_dictionary.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Sorted terms with front coding. Terms are grouped into blocks of BLOCK_SIZE; the first term of a
+// block is stored whole and every other one as the length of the prefix it shares with the previous
+// term followed by the rest of it. A binary search over the first terms of blocks finds where a
+// prefix starts, and its terms are then decoded one after another.
+class FrontCodedTerms {
+public:
+	using TermId = TermDictionary::TermId;
+	static constexpr size_t BLOCK_SIZE = 16;
+
+	// Terms must be appended in increasing order.
+	void Append(std::string_view term, TermId term_id);
+	static FrontCodedTerms Merge(const FrontCodedTerms& lhs, const FrontCodedTerms& rhs);
+
+	size_t Size() const;
+	// Appends the ids of the terms that start with prefix.
+	void FindPrefix(std::string_view prefix, std::vector<TermId>& term_ids) const;
+
+	size_t GetMemoryUsage() const;
+
+private:
+	class Reader;
+
+	std::vector<uint8_t> data_;
+	std::vector<uint32_t> block_offsets_;
+	size_t size_ = 0;
+	// Last appended term, which the next one is coded against.
+	std::string last_term_;
+
+	std::string_view GetBlockFirstTerm(size_t block) const;
+};
+
+// Prefix search over the terms of a TermDictionary. Terms arrive in the order of their ids rather than
+// sorted, so they are kept the way a log-structured merge tree keeps keys: new terms go to a small
+// sorted buffer, a full buffer becomes a front-coded run, and runs of similar sizes are merged. Every
+// term is thus recoded O(log n) times, and a lookup searches O(log n) runs.
+class PrefixTermIndex {
+public:
+	using TermId = TermDictionary::TermId;
+
+	// Adds the terms interned by the dictionary since the last update.
+	void Update(const TermDictionary& terms);
+
+	// Appends the ids of the terms that start with prefix, in no particular order.
+	void FindTerms(std::string_view prefix, std::vector<TermId>& term_ids) const;
+	// Same for the terms whose document frequency is not zero, and only the max_count most frequent of them
+	// if there are more; document_freq maps a term id to its frequency.
+	template <typename DocumentFreq>
+	void FindFrequentTerms(std::string_view prefix, size_t max_count, DocumentFreq document_freq, std::vector<TermId>& term_ids) const;
+
+	size_t GetMemoryUsage() const;
+
+private:
+	static constexpr size_t BUFFER_SIZE = 256;
+
+	size_t term_count_ = 0;
+	// Sorted terms not in a run yet; the views point into the dictionary.
+	std::vector<std::pair<std::string_view, TermId>> buffer_;
+	// Sizes decrease by at least half from one run to the next.
+	std::vector<FrontCodedTerms> runs_;
+
+	void FlushBuffer();
+};
+
+template <typename DocumentFreq>
+void PrefixTermIndex::FindFrequentTerms(std::string_view prefix, size_t max_count, DocumentFreq document_freq, std::vector<TermId>& term_ids) const {
+	const size_t first = term_ids.size();
+	FindTerms(prefix, term_ids);
+	// Terms are never removed from the dictionary, but their documents can be.
+	term_ids.erase(std::remove_if(term_ids.begin() + first, term_ids.end(), [&document_freq](TermId term_id) {
+		return document_freq(term_id) == 0;
+	}), term_ids.end());
+	if (term_ids.size() - first > max_count) {
+		std::nth_element(term_ids.begin() + first, term_ids.begin() + first + max_count, term_ids.end(), [&document_freq](TermId lhs, TermId rhs) {
+			const auto lhs_freq = document_freq(lhs);
+			const auto rhs_freq = document_freq(rhs);
+			return lhs_freq > rhs_freq || (lhs_freq == rhs_freq && lhs < rhs);
+		});
+		term_ids.resize(first + max_count);
+	}
+}
@@ -10,7 +10,16 @@ std::vector<std::vector<Document>> ProcessQueries(
     const std::vector<std::string>& queries) {
     std::vector<std::vector<Document>> out(queries.size());
     std::transform(std::execution::par, queries.begin(), queries.end(), out.begin(),
-        [&search_server](auto q) {return search_server.FindTopDocuments(q); });
+        [&search_server](const std::string& q) {return search_server.FindTopDocuments(q); });
+    return out;
+}
+
+std::vector<std::vector<Document>> ProcessQueries(
+    QueryCache& query_cache,
+    const std::vector<std::string>& queries) {
+    std::vector<std::vector<Document>> out(queries.size());
+    std::transform(std::execution::par, queries.begin(), queries.end(), out.begin(),
+        [&query_cache](const std::string& q) {return query_cache.FindTopDocuments(q); });
     return out;
 }
 
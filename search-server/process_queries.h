@@ -2,6 +2,7 @@
 #include <vector>
 #include <list>
 #include "search_server.h"
+#include "query_cache.h"
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
@@ -9,3 +10,8 @@ std::vector<std::vector<Document>> ProcessQueries(
 std::vector<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
+
+// ProcessQueries through a cache shared by all threads.
+std::vector<std::vector<Document>> ProcessQueries(
+    QueryCache& query_cache,
+    const std::vector<std::string>& queries);
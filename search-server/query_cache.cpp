@@ -0,0 +1,76 @@
+#include "query_cache.h"
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+using namespace std;
+
+QueryCache::QueryCache(const SearchServer& search_server, size_t capacity)
+	: search_server_(search_server)
+	, shards_(clamp<size_t>(capacity / MIN_SHARD_CAPACITY, 1, max(1u, thread::hardware_concurrency()) * 4))
+	, shard_capacity_(max<size_t>(1, capacity / shards_.size()))
+{
+}
+
+vector<Document> QueryCache::FindTopDocuments(const string_view raw_query, DocumentStatus status, size_t max_result_count) {
+	string key = to_string(static_cast<int>(status)) + ' ' + to_string(max_result_count) + ' ' + search_server_.NormalizeQuery(raw_query);
+	const uint64_t generation = search_server_.GetGeneration();
+	Shard& shard = GetShard(key);
+	{
+		lock_guard<mutex> lock(shard.mutex);
+		const auto it = shard.positions.find(key);
+		if (it != shard.positions.end()) {
+			if (it->second->generation == generation) {
+				shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+				++hit_count_;
+				return shard.entries.front().documents;
+			}
+			++stale_count_;
+			const auto position = it->second;
+			shard.positions.erase(it);
+			shard.entries.erase(position);
+		}
+	}
+	++miss_count_;
+
+	// Searching is done outside of the lock, so concurrent misses of one query may compute it twice.
+	vector<Document> documents = search_server_.FindTopDocuments(raw_query, status, max_result_count);
+	lock_guard<mutex> lock(shard.mutex);
+	if (shard.positions.count(key) == 0) {
+		shard.entries.push_front({ move(key), generation, documents });
+		shard.positions.emplace(shard.entries.front().key, shard.entries.begin());
+		if (shard.entries.size() > shard_capacity_) {
+			shard.positions.erase(shard.entries.back().key);
+			shard.entries.pop_back();
+		}
+	}
+	return documents;
+}
+
+vector<Document> QueryCache::FindTopDocuments(const string_view raw_query) {
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+QueryCache::Statistics QueryCache::GetStatistics() const {
+	Statistics statistics;
+	statistics.hit_count = hit_count_;
+	statistics.miss_count = miss_count_;
+	statistics.stale_count = stale_count_;
+	for (const Shard& shard : shards_) {
+		lock_guard<mutex> lock(shard.mutex);
+		statistics.entry_count += shard.entries.size();
+	}
+	return statistics;
+}
+
+void QueryCache::Clear() {
+	for (Shard& shard : shards_) {
+		lock_guard<mutex> lock(shard.mutex);
+		shard.positions.clear();
+		shard.entries.clear();
+	}
+}
+
+QueryCache::Shard& QueryCache::GetShard(const string& key) {
+	return shards_[hash<string>{}(key) % shards_.size()];
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "document.h"
+#include "search_server.h"
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// LRU cache of search results in front of a search server. Queries are keyed by their normalized
+// text, status and result count, so reordered or repeated words share an entry. Every entry remembers
+// the generation of the server it was computed at and is recomputed once the server has changed.
+// The cache is sharded and may be used from many threads, as long as the server is not modified concurrently.
+class QueryCache {
+public:
+	static constexpr size_t DEFAULT_CAPACITY = 4096;
+	// Small caches get fewer shards, so that the eviction order stays close to a global LRU.
+	static constexpr size_t MIN_SHARD_CAPACITY = 64;
+
+	struct Statistics {
+		uint64_t hit_count = 0;
+		uint64_t miss_count = 0;
+		// Misses that found an entry computed before the last change of the server.
+		uint64_t stale_count = 0;
+		size_t entry_count = 0;
+	};
+
+	explicit QueryCache(const SearchServer& search_server, size_t capacity = DEFAULT_CAPACITY);
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT);
+	std::vector<Document> FindTopDocuments(std::string_view raw_query);
+
+	Statistics GetStatistics() const;
+	void Clear();
+
+private:
+	struct Entry {
+		std::string key;
+		uint64_t generation;
+		std::vector<Document> documents;
+	};
+
+	struct Shard {
+		mutable std::mutex mutex;
+		// The most recently used entry first; the index refers to the keys of the entries.
+		std::list<Entry> entries;
+		std::unordered_map<std::string_view, std::list<Entry>::iterator> positions;
+	};
+
+	const SearchServer& search_server_;
+	std::vector<Shard> shards_;
+	const size_t shard_capacity_;
+	std::atomic<uint64_t> hit_count_ = 0;
+	std::atomic<uint64_t> miss_count_ = 0;
+	std::atomic<uint64_t> stale_count_ = 0;
+
+	Shard& GetShard(const std::string& key);
+};
@@ -0,0 +1,142 @@
+#include "query_executor.h"
+#include <algorithm>
+#include <iterator>
+
+using namespace std;
+
+size_t QueryBatchResults::GetQueryCount() const {
+	return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+IteratorRange<vector<Document>::const_iterator> QueryBatchResults::operator[](size_t query_index) const {
+	return { documents.begin() + offsets[query_index], documents.begin() + offsets[query_index + 1] };
+}
+
+QueryExecutor::QueryExecutor(const SearchServer& search_server, size_t thread_count)
+	: search_server_(search_server)
+{
+	for (size_t i = 0; i < max<size_t>(1, thread_count); ++i) {
+		workers_.push_back(make_unique<Worker>());
+	}
+	for (size_t i = 0; i < workers_.size(); ++i) {
+		workers_[i]->thread = thread([this, i] { RunWorker(i); });
+	}
+}
+
+QueryExecutor::~QueryExecutor() {
+	{
+		lock_guard<mutex> lock(state_mutex_);
+		is_stopping_ = true;
+	}
+	work_available_.notify_all();
+	for (auto& worker : workers_) {
+		worker->thread.join();
+	}
+}
+
+QueryBatchResults QueryExecutor::Run(const vector<string>& queries, DocumentStatus status, size_t max_result_count) {
+	lock_guard<mutex> run_lock(run_mutex_);
+	vector<Document> slots(queries.size() * max_result_count);
+	vector<size_t> counts(queries.size());
+	batch_ = { &queries, status, max_result_count, &slots, &counts };
+	error_ = nullptr;
+
+	// The count is set before the tasks are dealt, since a worker still stealing after the last batch may take them at once.
+	const size_t task_count = (queries.size() + TASK_SIZE - 1) / TASK_SIZE;
+	pending_task_count_ = task_count;
+	for (size_t task = 0; task < task_count; ++task) {
+		Worker& worker = *workers_[task % workers_.size()];
+		lock_guard<mutex> lock(worker.mutex);
+		worker.tasks.push_back({ task * TASK_SIZE, min(queries.size(), (task + 1) * TASK_SIZE) });
+	}
+	if (task_count > 0) {
+		{
+			lock_guard<mutex> lock(state_mutex_);
+			++batch_number_;
+		}
+		work_available_.notify_all();
+		unique_lock<mutex> lock(state_mutex_);
+		batch_finished_.wait(lock, [this] { return pending_task_count_.load(memory_order_acquire) == 0; });
+	}
+	if (error_) {
+		rethrow_exception(error_);
+	}
+
+	// The results are moved to the front of the buffer; no query moves past its own slot.
+	QueryBatchResults results;
+	results.offsets.reserve(queries.size() + 1);
+	results.offsets.push_back(0);
+	for (size_t i = 0; i < queries.size(); ++i) {
+		const auto slot = slots.begin() + i * max_result_count;
+		move(slot, slot + counts[i], slots.begin() + results.offsets.back());
+		results.offsets.push_back(results.offsets.back() + counts[i]);
+	}
+	slots.resize(results.offsets.back());
+	results.documents = move(slots);
+	return results;
+}
+
+size_t QueryExecutor::GetThreadCount() const {
+	return workers_.size();
+}
+
+void QueryExecutor::RunWorker(size_t worker_index) {
+	Worker& worker = *workers_[worker_index];
+	uint64_t last_batch_number = 0;
+	while (true) {
+		{
+			unique_lock<mutex> lock(state_mutex_);
+			work_available_.wait(lock, [&] { return is_stopping_ || batch_number_ != last_batch_number; });
+			if (is_stopping_) {
+				return;
+			}
+			last_batch_number = batch_number_;
+		}
+		Task task;
+		while (TakeTask(worker_index, task)) {
+			ExecuteTask(task, worker.context);
+			if (pending_task_count_.fetch_sub(1, memory_order_acq_rel) == 1) {
+				lock_guard<mutex> lock(state_mutex_);
+				batch_finished_.notify_one();
+			}
+		}
+	}
+}
+
+bool QueryExecutor::TakeTask(size_t worker_index, Task& task) {
+	{
+		Worker& worker = *workers_[worker_index];
+		lock_guard<mutex> lock(worker.mutex);
+		if (!worker.tasks.empty()) {
+			task = worker.tasks.back();
+			worker.tasks.pop_back();
+			return true;
+		}
+	}
+	for (size_t i = 1; i < workers_.size(); ++i) {
+		Worker& victim = *workers_[(worker_index + i) % workers_.size()];
+		lock_guard<mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void QueryExecutor::ExecuteTask(const Task& task, SearchServer::QueryContext& context) {
+	for (size_t i = task.first; i < task.last; ++i) {
+		try {
+			const vector<Document> documents = search_server_.FindTopDocuments(context, (*batch_.queries)[i], batch_.status, batch_.max_result_count);
+			copy(documents.begin(), documents.end(), batch_.slots->begin() + i * batch_.max_result_count);
+			(*batch_.counts)[i] = documents.size();
+		}
+		catch (...) {
+			lock_guard<mutex> lock(error_mutex_);
+			if (!error_) {
+				error_ = current_exception();
+			}
+		}
+	}
+}
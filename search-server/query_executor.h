@@ -0,0 +1,85 @@
+#pragma once
+#include "document.h"
+#include "paginator.h"
+#include "search_server.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Results of a batch in one buffer: the documents of query i are documents[offsets[i], offsets[i + 1]).
+struct QueryBatchResults {
+	std::vector<Document> documents;
+	std::vector<size_t> offsets;
+
+	size_t GetQueryCount() const;
+	IteratorRange<std::vector<Document>::const_iterator> operator[](size_t query_index) const;
+};
+
+// Fixed pool of threads that answers batches of queries. A batch is cut into small tasks dealt to
+// per-worker deques; a worker takes its own tasks from the back and steals from the front of the
+// others when it runs out. Every worker keeps its own query context, and results are written to
+// per-query slots of a preallocated buffer, which is compacted at the end of the batch.
+// Batches are run one at a time; the server must not be modified while a batch runs.
+class QueryExecutor {
+public:
+	// Number of queries in one task.
+	static constexpr size_t TASK_SIZE = 4;
+
+	explicit QueryExecutor(const SearchServer& search_server, size_t thread_count = std::max(1u, std::thread::hardware_concurrency()));
+	~QueryExecutor();
+
+	QueryExecutor(const QueryExecutor&) = delete;
+	QueryExecutor& operator=(const QueryExecutor&) = delete;
+
+	// Rethrows the first exception of an invalid query once the batch is done.
+	// The buffer holds max_result_count documents per query before compaction.
+	QueryBatchResults Run(const std::vector<std::string>& queries, DocumentStatus status = DocumentStatus::ACTUAL, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT);
+
+	size_t GetThreadCount() const;
+
+private:
+	struct Task {
+		size_t first;
+		size_t last;
+	};
+
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		SearchServer::QueryContext context;
+		std::thread thread;
+	};
+
+	struct Batch {
+		const std::vector<std::string>* queries = nullptr;
+		DocumentStatus status = DocumentStatus::ACTUAL;
+		size_t max_result_count = 0;
+		std::vector<Document>* slots = nullptr;
+		std::vector<size_t>* counts = nullptr;
+	};
+
+	const SearchServer& search_server_;
+	std::vector<std::unique_ptr<Worker>> workers_;
+	Batch batch_;
+	std::atomic<size_t> pending_task_count_ = 0;
+	std::mutex error_mutex_;
+	std::exception_ptr error_;
+
+	std::mutex run_mutex_;
+	std::mutex state_mutex_;
+	std::condition_variable work_available_;
+	std::condition_variable batch_finished_;
+	uint64_t batch_number_ = 0;
+	bool is_stopping_ = false;
+
+	void RunWorker(size_t worker_index);
+	bool TakeTask(size_t worker_index, Task& task);
+	void ExecuteTask(const Task& task, SearchServer::QueryContext& context);
+};
@@ -0,0 +1,78 @@
+#include "query_parser.h"
+#include "string_processing.h"
+#include <stdexcept>
+using namespace std;
+
+namespace {
+
+QueryWord ParseQueryWord(string_view text, const function<bool(string_view)>& is_stop_word) {
+	if (text.empty()) {
+		throw invalid_argument("invalid query!"s);
+	}
+
+	bool is_minus = false;
+	if (text[0] == '-') {
+		is_minus = true;
+		text = text.substr(1);
+	}
+	bool is_prefix = false;
+	if (!text.empty() && text.back() == '*') {
+		is_prefix = true;
+		text.remove_suffix(1);
+	}
+	if (text.empty() || text[0] == '-' || !IsValidText(text)) {
+		throw invalid_argument("invalid query!"s);
+	}
+	QueryWord query_word{ text, is_minus, !is_prefix && is_stop_word(text) };
+	query_word.is_prefix = is_prefix;
+	return query_word;
+}
+
+} // namespace
+
+void ParseQueryWords(const string_view text, const function<bool(string_view)>& is_stop_word, vector<string_view>& words, vector<QueryWord>& query_words) {
+	words.clear();
+	query_words.clear();
+	SplitIntoWords(text, words);
+	// A phrase opens with a quote before its first word and closes with a quote after its last word.
+	int phrase_count = 0;
+	bool is_in_phrase = false;
+	uint32_t phrase_offset = 0;
+	for (string_view word : words) {
+		if (!word.empty() && word[0] == '"') {
+			if (is_in_phrase) {
+				throw invalid_argument("invalid query!"s);
+			}
+			word.remove_prefix(1);
+			is_in_phrase = true;
+			phrase_offset = 0;
+		}
+		const bool closes_phrase = is_in_phrase && !word.empty() && word.back() == '"';
+		if (closes_phrase) {
+			word.remove_suffix(1);
+		}
+		if (word.find('"') != string_view::npos) {
+			throw invalid_argument("invalid query!"s);
+		}
+		QueryWord query_word = ParseQueryWord(word, is_stop_word);
+		if (is_in_phrase) {
+			if (query_word.is_minus || query_word.is_prefix) {
+				throw invalid_argument("invalid query!"s);
+			}
+			query_word.phrase = phrase_count;
+			query_word.phrase_offset = phrase_offset;
+			// Leading stop words do not take part in the phrase.
+			if (!query_word.is_stop || phrase_offset > 0) {
+				++phrase_offset;
+			}
+		}
+		query_words.push_back(query_word);
+		if (closes_phrase) {
+			is_in_phrase = false;
+			++phrase_count;
+		}
+	}
+	if (is_in_phrase) {
+		throw invalid_argument("invalid query!"s);
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+// Query syntax shared by the search servers. Words are separated by spaces; a word starting with a minus
+// excludes the documents that contain it, and a word ending with an asterisk, such as cat*, stands for the
+// indexed terms that start with it. Words between a quote before the first of them and a quote after the
+// last one form a phrase.
+
+// A prefix word stands for at most this many terms, those with the largest document frequencies.
+inline constexpr size_t MAX_PREFIX_EXPANSIONS = 64;
+
+struct QueryWord {
+	static constexpr int NO_PHRASE = -1;
+
+	std::string_view data;
+	bool is_minus;
+	bool is_stop;
+	// Index of the phrase of the word in the query.
+	int phrase = NO_PHRASE;
+	// Distance from the first word of the phrase that is not a stop word.
+	uint32_t phrase_offset = 0;
+	// The word is a prefix of the terms to search for.
+	bool is_prefix = false;
+};
+
+// Splits the query into words and resolves the quotes of phrases; throws invalid_argument if the query is malformed.
+void ParseQueryWords(std::string_view text, const std::function<bool(std::string_view)>& is_stop_word,
+	std::vector<std::string_view>& words, std::vector<QueryWord>& query_words);
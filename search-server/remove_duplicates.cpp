@@ -1,34 +1,213 @@
 #include "remove_duplicates.h"
-#include "log_duration.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <limits>
+#include <memory>
+#include <numeric>
 
 using namespace std;
 
-void RemoveDuplicates(SearchServer& search_server) {
+namespace {
+	constexpr size_t MINHASH_SIZE = 64;
 
-	set<set<string_view>> words_set;
-	set<int> delete_list;
-	for (auto doc_id : search_server) {
-		set<string_view> words = GetKeys(search_server.GetWordFrequencies(doc_id));
-		if (words_set.find(words) != words_set.end()) {
-			delete_list.insert(doc_id);
+	uint64_t MixHash(uint64_t value) {
+		value += 0x9E3779B97F4A7C15ull;
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+		return value ^ (value >> 31);
+	}
+
+	// Sorted term ids of every live document, in the order of document ids.
+	struct DocumentTermSets {
+		vector<int> document_ids;
+		vector<vector<PostingIndex::TermId>> terms;
+	};
+
+	DocumentTermSets CollectTermSets(const SearchServer& search_server) {
+		DocumentTermSets term_sets;
+		term_sets.document_ids.assign(search_server.begin(), search_server.end());
+		term_sets.terms.resize(term_sets.document_ids.size());
+		vector<size_t> positions(term_sets.document_ids.size());
+		iota(positions.begin(), positions.end(), 0);
+		for_each(execution::par, positions.begin(), positions.end(), [&](size_t position) {
+			auto& terms = term_sets.terms[position];
+			for (const auto& [term_id, freq] : search_server.GetDocumentTerms(term_sets.document_ids[position])) {
+				terms.push_back(term_id);
+			}
+		});
+		return term_sets;
+	}
+
+	double ComputeJaccard(const vector<PostingIndex::TermId>& lhs, const vector<PostingIndex::TermId>& rhs) {
+		if (lhs.empty() && rhs.empty()) {
+			return 1;
 		}
-		else {
-			words_set.insert(words);
+		size_t common = 0;
+		for (size_t i = 0, j = 0; i < lhs.size() && j < rhs.size();) {
+			if (lhs[i] < rhs[j]) {
+				++i;
+			}
+			else if (rhs[j] < lhs[i]) {
+				++j;
+			}
+			else {
+				++common;
+				++i;
+				++j;
+			}
 		}
+		return static_cast<double>(common) / (lhs.size() + rhs.size() - common);
 	}
 
-	for (auto id : delete_list) {
-		std::cout << "Found duplicate document id "s << id << std::endl;
-		search_server.RemoveDocument(id);
+	// Groups documents by key and calls confirm(group) for every group of several documents in parallel.
+	// Documents of a group are ordered by their position, which follows the document ids.
+	template <typename Confirm>
+	void ForEachCollisionGroup(vector<pair<uint64_t, int>>& keys, Confirm confirm) {
+		sort(execution::par, keys.begin(), keys.end());
+		vector<size_t> group_starts;
+		for (size_t i = 0; i < keys.size(); ++i) {
+			if (i == 0 || keys[i].first != keys[i - 1].first) {
+				group_starts.push_back(i);
+			}
+		}
+		group_starts.push_back(keys.size());
+		vector<size_t> groups(group_starts.size() - 1);
+		iota(groups.begin(), groups.end(), 0);
+		for_each(execution::par, groups.begin(), groups.end(), [&](size_t group) {
+			if (group_starts[group + 1] - group_starts[group] > 1) {
+				confirm(keys.begin() + group_starts[group], keys.begin() + group_starts[group + 1]);
+			}
+		});
 	}
 
+	vector<int> CollectDuplicates(const DocumentTermSets& term_sets, const unique_ptr<atomic<bool>[]>& is_duplicate) {
+		vector<int> duplicates;
+		for (size_t i = 0; i < term_sets.document_ids.size(); ++i) {
+			if (is_duplicate[i].load(memory_order_relaxed)) {
+				duplicates.push_back(term_sets.document_ids[i]);
+			}
+		}
+		return duplicates;
+	}
 }
 
-template <typename key, typename value>
-set<key> GetKeys(const map<key, value>& in) {
-	set<key> out;
-	for (auto [k, v] : in) {
-		out.insert(k);
+vector<int> FindDuplicates(const SearchServer& search_server, DuplicateReport& report) {
+	const DocumentTermSets term_sets = CollectTermSets(search_server);
+	const size_t document_count = term_sets.document_ids.size();
+
+	vector<pair<uint64_t, int>> fingerprints(document_count);
+	vector<int> positions(document_count);
+	iota(positions.begin(), positions.end(), 0);
+	transform(execution::par, positions.begin(), positions.end(), fingerprints.begin(), [&](int position) {
+		uint64_t fingerprint = MixHash(term_sets.terms[position].size());
+		for (const PostingIndex::TermId term_id : term_sets.terms[position]) {
+			fingerprint = MixHash(fingerprint ^ term_id);
+		}
+		return pair{ fingerprint, position };
+	});
+
+	auto is_duplicate = make_unique<atomic<bool>[]>(document_count);
+	atomic<size_t> false_candidate_count = 0;
+	ForEachCollisionGroup(fingerprints, [&](auto first, auto last) {
+		// Distinct word sets that happen to share the fingerprint are kept apart.
+		vector<int> kept_positions;
+		for (auto it = first; it != last; ++it) {
+			const auto& terms = term_sets.terms[it->second];
+			const bool is_copy = any_of(kept_positions.begin(), kept_positions.end(), [&](int kept) {
+				return term_sets.terms[kept] == terms;
+			});
+			if (is_copy) {
+				is_duplicate[it->second].store(true, memory_order_relaxed);
+			}
+			else {
+				if (!kept_positions.empty()) {
+					false_candidate_count.fetch_add(1, memory_order_relaxed);
+				}
+				kept_positions.push_back(it->second);
+			}
+		}
+	});
+
+	vector<int> duplicates = CollectDuplicates(term_sets, is_duplicate);
+	report.document_count = document_count;
+	report.duplicate_count = duplicates.size();
+	report.false_candidate_count = false_candidate_count;
+	return duplicates;
+}
+
+vector<int> FindNearDuplicates(const SearchServer& search_server, double jaccard_threshold, DuplicateReport& report) {
+	const DocumentTermSets term_sets = CollectTermSets(search_server);
+	const size_t document_count = term_sets.document_ids.size();
+
+	// Two documents share a band of r rows out of b with probability 1 - (1 - J^r)^b;
+	// the band width puts the steepest part of that curve just below the threshold.
+	size_t rows_per_band = 1;
+	while (rows_per_band * 2 <= MINHASH_SIZE && pow(1.0 / (MINHASH_SIZE / (rows_per_band * 2)), 1.0 / (rows_per_band * 2)) <= jaccard_threshold) {
+		rows_per_band *= 2;
+	}
+	const size_t band_count = MINHASH_SIZE / rows_per_band;
+
+	vector<uint64_t> signatures(document_count * MINHASH_SIZE, numeric_limits<uint64_t>::max());
+	vector<int> positions(document_count);
+	iota(positions.begin(), positions.end(), 0);
+	for_each(execution::par, positions.begin(), positions.end(), [&](int position) {
+		uint64_t* signature = &signatures[position * MINHASH_SIZE];
+		for (const PostingIndex::TermId term_id : term_sets.terms[position]) {
+			const uint64_t term_hash = MixHash(term_id);
+			for (size_t i = 0; i < MINHASH_SIZE; ++i) {
+				signature[i] = min(signature[i], MixHash(term_hash + i));
+			}
+		}
+	});
+
+	auto is_duplicate = make_unique<atomic<bool>[]>(document_count);
+	atomic<size_t> false_candidate_count = 0;
+	vector<pair<uint64_t, int>> band_keys(document_count);
+	for (size_t band = 0; band < band_count; ++band) {
+		for (size_t position = 0; position < document_count; ++position) {
+			uint64_t key = MixHash(band);
+			for (size_t row = 0; row < rows_per_band; ++row) {
+				key = MixHash(key ^ signatures[position * MINHASH_SIZE + band * rows_per_band + row]);
+			}
+			band_keys[position] = { key, static_cast<int>(position) };
+		}
+		ForEachCollisionGroup(band_keys, [&](auto first, auto last) {
+			for (auto it = first + 1; it != last; ++it) {
+				if (is_duplicate[it->second].load(memory_order_relaxed)) {
+					continue;
+				}
+				const auto& terms = term_sets.terms[it->second];
+				const bool is_similar = any_of(first, it, [&](const pair<uint64_t, int>& earlier) {
+					return ComputeJaccard(term_sets.terms[earlier.second], terms) >= jaccard_threshold;
+				});
+				if (is_similar) {
+					is_duplicate[it->second].store(true, memory_order_relaxed);
+				}
+				else {
+					false_candidate_count.fetch_add(1, memory_order_relaxed);
+				}
+			}
+		});
 	}
-	return out;
-}
\ No newline at end of file
+
+	vector<int> duplicates = CollectDuplicates(term_sets, is_duplicate);
+	report.document_count = document_count;
+	report.duplicate_count = duplicates.size();
+	report.false_candidate_count = false_candidate_count;
+	return duplicates;
+}
+
+DuplicateReport RemoveDuplicates(SearchServer& search_server) {
+	DuplicateReport report;
+	search_server.RemoveDocuments(FindDuplicates(search_server, report));
+	return report;
+}
+
+DuplicateReport RemoveNearDuplicates(SearchServer& search_server, double jaccard_threshold) {
+	DuplicateReport report;
+	search_server.RemoveDocuments(FindNearDuplicates(search_server, jaccard_threshold, report));
+	return report;
+}
@@ -1,7 +1,23 @@
 #pragma once
 #include "search_server.h"
+#include <vector>
 
-void RemoveDuplicates(SearchServer& search_server);
+struct DuplicateReport {
+	size_t document_count = 0;
+	size_t duplicate_count = 0;
+	// Candidates that shared a fingerprint or an LSH bucket with an earlier document but were not confirmed.
+	size_t false_candidate_count = 0;
+};
 
-template <typename key, typename value>
-std::set<key> GetKeys(const std::map<key, value>& in);
\ No newline at end of file
+// Documents with exactly the same set of words. Every document gets a fingerprint of its
+// sorted term ids in parallel; only documents with equal fingerprints are compared.
+// The document with the smallest id of every group is kept.
+std::vector<int> FindDuplicates(const SearchServer& search_server, DuplicateReport& report);
+
+// Documents whose word sets have a Jaccard similarity of at least jaccard_threshold with a
+// document of smaller id. Candidates come from MinHash signatures split into LSH bands and are
+// confirmed with the exact similarity, so some near-duplicates close to the threshold may be missed.
+std::vector<int> FindNearDuplicates(const SearchServer& search_server, double jaccard_threshold, DuplicateReport& report);
+
+DuplicateReport RemoveDuplicates(SearchServer& search_server);
+DuplicateReport RemoveNearDuplicates(SearchServer& search_server, double jaccard_threshold);
@@ -0,0 +1,51 @@
+#pragma once
+#include "posting_index.h"
+#include <cmath>
+
+// Relevance functions for SearchServer::FindTopDocuments, chosen by a template argument.
+// A scoring gives every query term a weight once per query, scores the postings of the term with it,
+// and bounds those scores from above for early termination.
+namespace scoring {
+	struct CollectionStatistics {
+		double document_count;
+		double log_document_count;
+		double average_document_length;
+	};
+
+	// Term frequency normalized by the document length, times the inverse document frequency.
+	struct TfIdf {
+		static double ComputeTermWeight(const PostingList& postings, const CollectionStatistics& collection) {
+			return collection.log_document_count - postings.log_document_freq;
+		}
+
+		static double Score(double weight, double term_freq, int document_length, const CollectionStatistics& collection) {
+			return term_freq * weight;
+		}
+
+		static double ComputeMaxScore(double weight, const PostingList& postings, const CollectionStatistics& collection) {
+			return postings.max_term_freq * weight;
+		}
+	};
+
+	// Okapi BM25. Term frequencies are stored normalized, so with tf = count / length the usual
+	// count * (K1 + 1) / (count + K1 * (1 - B + B * length / average)) becomes the expression in Score.
+	struct Bm25 {
+		static constexpr double K1 = 1.2;
+		static constexpr double B = 0.75;
+
+		static double ComputeTermWeight(const PostingList& postings, const CollectionStatistics& collection) {
+			const double document_freq = static_cast<double>(postings.GetDocumentFreq());
+			return std::log(1 + (collection.document_count - document_freq + 0.5) / (document_freq + 0.5));
+		}
+
+		static double Score(double weight, double term_freq, int document_length, const CollectionStatistics& collection) {
+			return weight * term_freq * (K1 + 1) / (term_freq + K1 * ((1 - B) / document_length + B / collection.average_document_length));
+		}
+
+		// The score grows with both the term frequency and the document length, so the largest term
+		// frequency of the list with an unbounded length bounds it.
+		static double ComputeMaxScore(double weight, const PostingList& postings, const CollectionStatistics& collection) {
+			return weight * postings.max_term_freq * (K1 + 1) / (postings.max_term_freq + K1 * B / collection.average_document_length);
+		}
+	};
+}
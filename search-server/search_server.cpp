@@ -5,9 +5,26 @@
 #include <numeric>
 #include <cmath>
 #include <utility>
-#include <mutex>
+#include <thread>
+#include <limits>
+#include <unordered_set>
 using namespace std;
 
+namespace {
+
+// Position of the first value at or after from that is not less than value.
+size_t Gallop(const vector<uint32_t>& values, size_t from, uint32_t value) {
+	size_t step = 1;
+	while (from + step < values.size() && values[from + step] < value) {
+		step *= 2;
+	}
+	const auto first = values.begin() + min(from + step / 2, values.size());
+	const auto last = values.begin() + min(from + step + 1, values.size());
+	return lower_bound(first, last, value) - values.begin();
+}
+
+} // namespace
+
 SearchServer::SearchServer(const std::string& stop_words_text)
 	: SearchServer(SplitIntoWords(stop_words_text))
 {
@@ -20,125 +37,602 @@ SearchServer::SearchServer(const std::string_view stop_words_text)
 }
 
 void SearchServer::AddDocument(int document_id, const string_view document, DocumentStatus status, const vector<int>& ratings) {
-	if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+	if ((document_id < 0) || (id_to_ordinal_.count(document_id) > 0)) {
 		throw invalid_argument("invalid document id!"s);
 	}
-	vector<string> words;
-	words = SplitIntoWordsNoStop(document);
-	set<string> words_set;
-	const double inv_word_count = 1.0 / words.size();
-	for (string& word : words) {
-		auto iter = words_set.insert(words_set.begin(), move(word));
-		word_to_document_freqs_[string_view(*iter)][document_id] += inv_word_count;
-		id_to_words_freqs_[document_id][string_view(*iter)] += inv_word_count;
+	vector<string_view> words;
+	vector<uint32_t> positions;
+	const bool is_valid = positions_ ? SplitIntoWordsNoStop(document, words, positions) : SplitIntoWordsNoStop(document, words);
+	if (!is_valid) {
+		throw invalid_argument("invalid document!"s);
 	}
+	const auto word_freqs = ComputeWordFreqs(words);
 
-	documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status, move(words_set) });
-	document_ids_.insert(document_id);
+	const int ordinal = AllocateOrdinal(DocumentData{ document_id, ComputeAverageRating(ratings), status, static_cast<int>(words.size()) });
+	auto& document_words = documents_words_freqs_[ordinal];
+	document_words.reserve(word_freqs.size());
+	for (const auto& [word, term_freq] : word_freqs) {
+		document_words.push_back({ index_.AddPosting(word, ordinal, term_freq, static_cast<uint8_t>(status)), term_freq });
+	}
+	if (positions_) {
+		vector<PostingIndex::TermId> word_terms;
+		word_terms.reserve(document_words.size());
+		for (const TermFrequency& word : document_words) {
+			word_terms.push_back(word.term_id);
+		}
+		positions_->SetDocument(ordinal, ComputeTermPositions(words, positions, word_freqs, word_terms));
+	}
+	sort(document_words.begin(), document_words.end(), [](const TermFrequency& lhs, const TermFrequency& rhs) {
+		return lhs.term_id < rhs.term_id;
+	});
+	prefix_terms_.Update(index_.GetTermDictionary());
+
+	UpdateDocumentCount();
 }
 
-vector<Document> SearchServer::FindTopDocuments(const string_view raw_query, DocumentStatus status) const {
-	return FindTopDocuments(
-		raw_query,
-		[status](int document_id, DocumentStatus document_status, int rating) {
-			return document_status == status;
-		});
+void SearchServer::AddDocuments(const vector<NewDocument>& documents) {
+	unordered_set<int> batch_ids;
+	for (const NewDocument& document : documents) {
+		if ((document.id < 0) || (id_to_ordinal_.count(document.id) > 0) || !batch_ids.insert(document.id).second) {
+			throw invalid_argument("invalid document id!"s);
+		}
+	}
+
+	struct ParsedDocument {
+		vector<pair<string_view, double>> word_freqs;
+		// Kept only for the positional index.
+		vector<string_view> words;
+		vector<uint32_t> positions;
+		int word_count = 0;
+		bool is_valid = false;
+	};
+
+	const size_t chunk_count = max<size_t>(1, min<size_t>(max(1u, thread::hardware_concurrency()) * 4, documents.size()));
+	const size_t chunk_size = (documents.size() + chunk_count - 1) / chunk_count;
+	vector<size_t> chunk_indices(chunk_count);
+	iota(chunk_indices.begin(), chunk_indices.end(), 0);
+
+	vector<ParsedDocument> parsed_documents(documents.size());
+	for_each(execution::par, chunk_indices.begin(), chunk_indices.end(), [&](size_t chunk) {
+		const size_t first = chunk * chunk_size;
+		const size_t last = min(documents.size(), first + chunk_size);
+		vector<string_view> words;
+		for (size_t i = first; i < last; ++i) {
+			ParsedDocument& parsed = parsed_documents[i];
+			words.clear();
+			parsed.is_valid = positions_ ? SplitIntoWordsNoStop(documents[i].text, words, parsed.positions) : SplitIntoWordsNoStop(documents[i].text, words);
+			if (!parsed.is_valid) {
+				continue;
+			}
+			parsed.word_count = static_cast<int>(words.size());
+			parsed.word_freqs = ComputeWordFreqs(words);
+			if (positions_) {
+				parsed.words = words;
+			}
+		}
+	});
+	if (!all_of(parsed_documents.begin(), parsed_documents.end(), [](const ParsedDocument& parsed) { return parsed.is_valid; })) {
+		throw invalid_argument("invalid document!"s);
+	}
+
+	// Words are interned and their postings grouped by term in one sequential pass, with a single lookup
+	// per word as in AddDocument; the terms are then merged into the index in parallel.
+	vector<int> ordinals(documents.size());
+	vector<vector<Posting>> term_postings(index_.GetTermCount());
+	vector<PostingIndex::TermId> touched_terms;
+	for (size_t i = 0; i < documents.size(); ++i) {
+		const NewDocument& document = documents[i];
+		const ParsedDocument& parsed = parsed_documents[i];
+		ordinals[i] = AllocateOrdinal(DocumentData{ document.id, ComputeAverageRating(document.ratings), document.status, parsed.word_count });
+		auto& document_words = documents_words_freqs_[ordinals[i]];
+		document_words.reserve(parsed.word_freqs.size());
+		for (const auto& [word, term_freq] : parsed.word_freqs) {
+			const PostingIndex::TermId term_id = index_.AddTerm(word);
+			if (term_id >= term_postings.size()) {
+				term_postings.resize(term_id + 1);
+			}
+			auto& postings = term_postings[term_id];
+			if (postings.empty()) {
+				touched_terms.push_back(term_id);
+			}
+			postings.push_back({ ordinals[i], term_freq, static_cast<uint8_t>(document.status) });
+			document_words.push_back({ term_id, term_freq });
+		}
+	}
+	for_each(execution::par, touched_terms.begin(), touched_terms.end(), [&](PostingIndex::TermId term_id) {
+		auto& postings = term_postings[term_id];
+		// Recycled ordinals are not allocated in batch order.
+		auto by_document_id = [](const Posting& lhs, const Posting& rhs) {
+			return lhs.document_id < rhs.document_id;
+		};
+		if (!is_sorted(postings.begin(), postings.end(), by_document_id)) {
+			sort(postings.begin(), postings.end(), by_document_id);
+		}
+		index_.MergePostings(term_id, postings);
+	});
+
+	for_each(execution::par, chunk_indices.begin(), chunk_indices.end(), [&](size_t chunk) {
+		const size_t first = chunk * chunk_size;
+		const size_t last = min(documents.size(), first + chunk_size);
+		for (size_t i = first; i < last; ++i) {
+			const ParsedDocument& parsed = parsed_documents[i];
+			auto& document_words = documents_words_freqs_[ordinals[i]];
+			if (positions_) {
+				vector<PostingIndex::TermId> word_terms;
+				word_terms.reserve(document_words.size());
+				for (const TermFrequency& word : document_words) {
+					word_terms.push_back(word.term_id);
+				}
+				positions_->SetDocument(ordinals[i], ComputeTermPositions(parsed.words, parsed.positions, parsed.word_freqs, word_terms));
+			}
+			sort(document_words.begin(), document_words.end(), [](const TermFrequency& lhs, const TermFrequency& rhs) {
+				return lhs.term_id < rhs.term_id;
+			});
+		}
+	});
+	prefix_terms_.Update(index_.GetTermDictionary());
+
+	UpdateDocumentCount();
 }
 
-vector<Document> SearchServer::FindTopDocuments(const string_view raw_query) const {
-	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+void SearchServer::SelectTopDocuments(const execution::parallel_policy&, vector<Document>& documents, size_t max_count) {
+	const size_t chunk_count = max<size_t>(1, min<size_t>(thread::hardware_concurrency(), documents.size() / max<size_t>(max_count, 1)));
+	const size_t chunk_size = (documents.size() + chunk_count - 1) / chunk_count;
+	vector<TopDocumentsCollector> chunk_tops(chunk_count, TopDocumentsCollector(max_count));
+	vector<size_t> chunk_indices(chunk_count);
+	iota(chunk_indices.begin(), chunk_indices.end(), 0);
+
+	for_each(execution::par, chunk_indices.begin(), chunk_indices.end(), [&](size_t chunk) {
+		const size_t first = chunk * chunk_size;
+		const size_t last = min(documents.size(), first + chunk_size);
+		for (size_t i = first; i < last; ++i) {
+			chunk_tops[chunk].Add(documents[i]);
+		}
+	});
+
+	TopDocumentsCollector top(max_count);
+	for (const TopDocumentsCollector& chunk_top : chunk_tops) {
+		top.Merge(chunk_top);
+	}
+	documents = top.Extract();
 }
 
 int SearchServer::GetDocumentCount() const {
-	return documents_.size();
+	return document_ids_.size();
+}
+
+uint64_t SearchServer::GetGeneration() const {
+	return generation_;
+}
+
+string SearchServer::NormalizeQuery(const string_view raw_query) const {
+	QueryContext& thread_context = GetThreadQueryContext();
+	QueryContext nested_context;
+	QueryContext& context = thread_context.is_busy_ ? nested_context : thread_context;
+	const QueryContext::Usage usage(context);
+	ParseQuery(raw_query, context);
+
+	string normalized_query;
+	for (const PostingIndex::TermId term_id : context.plus_terms_) {
+		normalized_query.append(index_.GetTerm(term_id)).push_back(' ');
+	}
+	for (const PostingIndex::TermId term_id : context.minus_terms_) {
+		normalized_query.append("-"sv).append(index_.GetTerm(term_id)).push_back(' ');
+	}
+	// Phrases keep the gaps left by their stop words as asterisks, and their missing words as question marks.
+	const vector<PhraseTerm>& phrase_terms = context.phrase_terms_;
+	for (size_t i = 0; i < phrase_terms.size(); ++i) {
+		const PhraseTerm& term = phrase_terms[i];
+		if (i == 0 || phrase_terms[i - 1].phrase != term.phrase) {
+			normalized_query.push_back('"');
+		}
+		else {
+			for (uint32_t offset = phrase_terms[i - 1].offset + 1; offset < term.offset; ++offset) {
+				normalized_query.append("* "sv);
+			}
+		}
+		normalized_query.append(term.term_id == TermDictionary::NO_TERM ? "?"sv : index_.GetTerm(term.term_id));
+		if (i + 1 == phrase_terms.size() || phrase_terms[i + 1].phrase != term.phrase) {
+			normalized_query.push_back('"');
+		}
+		normalized_query.push_back(' ');
+	}
+	if (!normalized_query.empty()) {
+		normalized_query.pop_back();
+	}
+	return normalized_query;
+}
+
+void SearchServer::EnablePositions() {
+	if (!id_to_ordinal_.empty()) {
+		throw logic_error("positions can be enabled only for an empty server"s);
+	}
+	positions_.emplace();
+	positions_->Resize(documents_.size());
+}
+
+bool SearchServer::HasPositions() const {
+	return positions_.has_value();
+}
+
+void SearchServer::SetIdfUpdatePolicy(IdfUpdatePolicy policy) {
+	idf_update_policy_ = policy;
+	index_.SetDeferredDocumentFreqs(policy == IdfUpdatePolicy::DEFERRED);
+	if (policy == IdfUpdatePolicy::EAGER) {
+		RecomputeInverseDocumentFreqs();
+	}
+}
+
+void SearchServer::RecomputeInverseDocumentFreqs() {
+	++generation_;
+	UpdateCollectionStatistics();
+	index_.RecomputeDocumentFreqs();
+}
+
+void SearchServer::UpdateDocumentCount() {
+	++generation_;
+	if (idf_update_policy_ == IdfUpdatePolicy::EAGER) {
+		UpdateCollectionStatistics();
+	}
+}
+
+void SearchServer::UpdateCollectionStatistics() {
+	const int document_count = GetDocumentCount();
+	collection_.document_count = document_count;
+	collection_.log_document_count = log(document_count);
+	collection_.average_document_length = document_count > 0 ? static_cast<double>(total_word_count_) / document_count : 0;
+}
+
+IndexMemoryUsage SearchServer::GetIndexMemoryUsage() const {
+	IndexMemoryUsage usage;
+	usage.term_count = index_.GetTermCount();
+	usage.term_dictionary_bytes = index_.GetTermDictionary().GetMemoryUsage();
+	for (const auto& document_words : documents_words_freqs_) {
+		usage.document_terms_bytes += sizeof(document_words) + document_words.capacity() * sizeof(TermFrequency);
+	}
+	if (positions_) {
+		usage.position_bytes = positions_->GetMemoryUsage();
+	}
+	usage.prefix_index_bytes = prefix_terms_.GetMemoryUsage();
+	for (const PostingList& postings : index_.GetPostingLists()) {
+		usage.posting_count += postings.Size();
+		usage.posting_list_bytes += postings.GetMemoryUsage();
+	}
+	return usage;
+}
+
+void SearchServer::SaveSnapshot(const string& path) const {
+	SnapshotWriter writer;
+	writer.Write<uint64_t>(stop_words_.size());
+	for (const string& stop_word : stop_words_) {
+		writer.WriteString(stop_word);
+	}
+	writer.Write<uint64_t>(index_.GetTermCount());
+	for (PostingIndex::TermId term_id = 0; term_id < index_.GetTermCount(); ++term_id) {
+		const PostingList& postings = index_.GetPostings(term_id);
+		writer.WriteString(index_.GetTerm(term_id));
+		if (postings.deleted_count == 0) {
+			writer.Write(postings.max_term_freq);
+			writer.WriteArray(postings.document_ids.data(), postings.Size());
+			writer.WriteArray(postings.term_freqs.data(), postings.Size());
+		}
+		else {
+			// Tombstoned postings are purged on the way to disk, so a snapshot is always compact.
+			PostingList live_postings = postings;
+			live_postings.EraseDeleted(tombstones_);
+			writer.Write(live_postings.max_term_freq);
+			writer.WriteArray(live_postings.document_ids.data(), live_postings.Size());
+			writer.WriteArray(live_postings.term_freqs.data(), live_postings.Size());
+		}
+	}
+	writer.WriteArray(documents_.data(), documents_.size());
+	// Word frequencies are written field by field, like the postings, so that the padding of TermFrequency stays out of the file.
+	vector<PostingIndex::TermId> term_ids;
+	vector<double> freqs;
+	for (size_t ordinal = 0; ordinal < documents_words_freqs_.size(); ++ordinal) {
+		term_ids.clear();
+		freqs.clear();
+		if (!tombstones_[ordinal]) {
+			for (const auto& [term_id, freq] : documents_words_freqs_[ordinal]) {
+				term_ids.push_back(term_id);
+				freqs.push_back(freq);
+			}
+		}
+		writer.WriteArray(term_ids.data(), term_ids.size());
+		writer.WriteArray(freqs.data(), freqs.size());
+	}
+	vector<int> free_ordinals = free_ordinals_;
+	free_ordinals.insert(free_ordinals.end(), tombstoned_ordinals_.begin(), tombstoned_ordinals_.end());
+	writer.WriteArray(free_ordinals.data(), free_ordinals.size());
+	writer.Write<uint8_t>(positions_ ? 1 : 0);
+	if (positions_) {
+		positions_->Save(writer, tombstones_);
+	}
+	writer.SaveToFile(path);
+}
+
+SearchServer SearchServer::LoadSnapshot(const string& path) {
+	auto snapshot_file = make_shared<const MappedFile>(path);
+	SnapshotReader reader(*snapshot_file);
+	return SearchServer(reader, move(snapshot_file));
+}
+
+SearchServer::SearchServer(SnapshotReader& reader, shared_ptr<const MappedFile> snapshot_file)
+	: SearchServer(ReadStopWords(reader))
+{
+	snapshot_file_ = move(snapshot_file);
+
+	// Every posting list is restored with a single copy of its arrays; terms stay in the mapped file.
+	// The status tags are not stored and are set once the documents are read.
+	const uint64_t term_count = reader.Read<uint64_t>();
+	vector<PostingList> term_postings;
+	for (uint64_t i = 0; i < term_count; ++i) {
+		const PostingIndex::TermId term_id = index_.AddExternalTerm(reader.ReadString());
+		if (term_id != i) {
+			throw runtime_error("corrupted snapshot"s);
+		}
+		PostingList& postings = term_postings.emplace_back();
+		postings.max_term_freq = reader.Read<double>();
+		const auto [document_ids, document_count] = reader.ReadArray<int>();
+		const auto [term_freqs, term_freq_count] = reader.ReadArray<double>();
+		if (term_freq_count != document_count) {
+			throw runtime_error("corrupted snapshot"s);
+		}
+		postings.document_ids.assign(document_ids, document_ids + document_count);
+		postings.term_freqs.assign(term_freqs, term_freqs + term_freq_count);
+	}
+
+	const auto [documents, document_count] = reader.ReadArray<DocumentData>();
+	documents_.assign(documents, documents + document_count);
+	for (PostingIndex::TermId term_id = 0; term_id < term_postings.size(); ++term_id) {
+		PostingList& postings = term_postings[term_id];
+		postings.tags.reserve(postings.Size());
+		for (const int ordinal : postings.document_ids) {
+			if (ordinal < 0 || static_cast<size_t>(ordinal) >= documents_.size()) {
+				throw runtime_error("corrupted snapshot"s);
+			}
+			postings.tags.push_back(static_cast<uint8_t>(documents_[ordinal].status));
+		}
+		index_.SetPostings(term_id, move(postings));
+	}
+	documents_words_freqs_.resize(document_count);
+	tombstones_.resize(document_count);
+	for (auto& document_words : documents_words_freqs_) {
+		const auto [term_ids, word_count] = reader.ReadArray<PostingIndex::TermId>();
+		const auto [freqs, freq_count] = reader.ReadArray<double>();
+		if (freq_count != word_count) {
+			throw runtime_error("corrupted snapshot"s);
+		}
+		document_words.reserve(word_count);
+		for (size_t i = 0; i < word_count; ++i) {
+			if (term_ids[i] >= term_count) {
+				throw runtime_error("corrupted snapshot"s);
+			}
+			document_words.push_back({ term_ids[i], freqs[i] });
+		}
+	}
+	const auto [free_ordinals, free_ordinal_count] = reader.ReadArray<int>();
+	free_ordinals_.assign(free_ordinals, free_ordinals + free_ordinal_count);
+	if (reader.Read<uint8_t>() != 0) {
+		positions_.emplace();
+		positions_->Load(reader);
+		positions_->Resize(document_count);
+	}
+	if (!reader.IsEnd()) {
+		throw runtime_error("corrupted snapshot"s);
+	}
+
+	vector<bool> is_free(document_count);
+	for (const int ordinal : free_ordinals_) {
+		if (ordinal < 0 || static_cast<size_t>(ordinal) >= document_count) {
+			throw runtime_error("corrupted snapshot"s);
+		}
+		is_free[ordinal] = true;
+	}
+	for (size_t ordinal = 0; ordinal < document_count; ++ordinal) {
+		if (!is_free[ordinal]) {
+			id_to_ordinal_.emplace(documents_[ordinal].id, static_cast<int>(ordinal));
+			document_ids_.insert(documents_[ordinal].id);
+			total_word_count_ += documents_[ordinal].word_count;
+		}
+	}
+	prefix_terms_.Update(index_.GetTermDictionary());
+	UpdateDocumentCount();
+}
+
+vector<string_view> SearchServer::ReadStopWords(SnapshotReader& reader) {
+	vector<string_view> stop_words(reader.Read<uint64_t>());
+	for (string_view& stop_word : stop_words) {
+		stop_word = reader.ReadString();
+	}
+	return stop_words;
+}
+
+int SearchServer::FindOrdinal(int document_id) const {
+	const auto it = id_to_ordinal_.find(document_id);
+	return it == id_to_ordinal_.end() ? -1 : it->second;
+}
+
+PostingIndex::TermId SearchServer::FindDocumentTerm(int ordinal, string_view word) const {
+	const PostingIndex::TermId term_id = index_.FindTermId(word);
+	if (term_id == TermDictionary::NO_TERM) {
+		return term_id;
+	}
+	return index_.GetPostings(term_id).Contains(ordinal) ? term_id : TermDictionary::NO_TERM;
+}
+
+int SearchServer::AllocateOrdinal(DocumentData document_data) {
+	int ordinal;
+	if (free_ordinals_.empty()) {
+		ordinal = static_cast<int>(documents_.size());
+		documents_.push_back(document_data);
+		documents_words_freqs_.emplace_back();
+		tombstones_.push_back(false);
+		if (positions_) {
+			positions_->Resize(documents_.size());
+		}
+	}
+	else {
+		ordinal = free_ordinals_.back();
+		free_ordinals_.pop_back();
+		documents_[ordinal] = document_data;
+	}
+	id_to_ordinal_.emplace(document_data.id, ordinal);
+	document_ids_.insert(document_data.id);
+	total_word_count_ += document_data.word_count;
+	return ordinal;
+}
+
+void SearchServer::ReleaseOrdinal(int ordinal) {
+	const int document_id = documents_[ordinal].id;
+	id_to_ordinal_.erase(document_id);
+	document_ids_.erase(document_id);
+	total_word_count_ -= documents_[ordinal].word_count;
+	documents_words_freqs_[ordinal] = {};
+	if (positions_) {
+		positions_->ClearDocument(ordinal);
+	}
+	free_ordinals_.push_back(ordinal);
 }
 
 tuple<SearchServer::DocText, DocumentStatus> SearchServer::MatchDocument(const string_view raw_query, int document_id) const {
 	using namespace std::literals;
-	if (!document_ids_.count(document_id)) {
+	const int ordinal = FindOrdinal(document_id);
+	if (ordinal < 0) {
 		throw std::out_of_range("Wrong Id!"s);
 	}
 
 	Query query = ParseQuery(raw_query);
 	vector<string_view> matched_words;
-	const std::map<std::string_view, double>* const words = &id_to_words_freqs_.at(document_id);
 	for (string_view word : query.plus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
-		}
-		if ((*words).count(word)) {
-			matched_words.push_back(word);
+		const PostingIndex::TermId term_id = FindDocumentTerm(ordinal, word);
+		if (term_id != TermDictionary::NO_TERM) {
+			matched_words.push_back(index_.GetTerm(term_id));
 		}
 	}
 	for (string_view word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
+		const PostingList* postings = index_.Find(word);
+		if (postings == nullptr) {
 			continue;
 		}
-		if (word_to_document_freqs_.at(word).count(document_id)) {
+		if (postings->Contains(ordinal)) {
 			matched_words.clear();
 			break;
 		}
 	}
+	if (!ContainsPhrases(ordinal, query)) {
+		matched_words.clear();
+	}
 
 	std::set<std::string_view> s(matched_words.begin(), matched_words.end());
 	matched_words.assign(s.begin(), s.end());
 
-	return { matched_words, documents_.at(document_id).status };
+	return { matched_words, documents_[ordinal].status };
 }
 
-vector<string> SearchServer::SplitIntoWordsNoStop(const string_view text) const {
-	vector<string> words;
-	for (string_view word : SplitIntoWords(text)) {
-		if (!IsValidWord(word)) {
-			throw invalid_argument("invalid document!"s);
-		}
-		if (!IsStopWord(word)) {
-			words.push_back(std::string(word));
-		}
+vector<string_view> SearchServer::SplitIntoWordsNoStop(const string_view text) const {
+	vector<string_view> words;
+	if (!SplitIntoWordsNoStop(text, words)) {
+		throw invalid_argument("invalid document!"s);
 	}
 	return words;
 }
 
-int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
-	if (ratings.empty()) {
-		return 0;
+bool SearchServer::SplitIntoWordsNoStop(const string_view text, vector<string_view>& words) const {
+	const size_t first_word = words.size();
+	if (!SplitIntoValidWords(text, words)) {
+		return false;
+	}
+	if (!stop_words_sv_.empty()) {
+		words.erase(remove_if(words.begin() + first_word, words.end(), [this](string_view word) {
+			return IsStopWord(word);
+		}), words.end());
 	}
-	int rating_sum = accumulate(ratings.begin(), ratings.end(), 0);
-	return rating_sum / static_cast<int>(ratings.size());
+	return true;
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
-
-	if (text.empty()) {
-		throw invalid_argument("invalid query!"s);
+bool SearchServer::SplitIntoWordsNoStop(const string_view text, vector<string_view>& words, vector<uint32_t>& positions) const {
+	const size_t first_word = words.size();
+	if (!SplitIntoValidWords(text, words)) {
+		return false;
+	}
+	size_t kept = first_word;
+	for (size_t i = first_word; i < words.size(); ++i) {
+		if (!IsStopWord(words[i])) {
+			words[kept++] = words[i];
+			positions.push_back(static_cast<uint32_t>(i - first_word));
+		}
 	}
+	words.resize(kept);
+	return true;
+}
 
-	bool is_minus = false;
-	if (text[0] == '-') {
-		is_minus = true;
-		text = text.substr(1);
+vector<pair<string_view, double>> SearchServer::ComputeWordFreqs(vector<string_view> words) {
+	const double inv_word_count = 1.0 / words.size();
+	sort(words.begin(), words.end());
+	vector<pair<string_view, double>> word_freqs;
+	for (string_view word : words) {
+		if (word_freqs.empty() || word_freqs.back().first != word) {
+			word_freqs.push_back({ word, 0 });
+		}
+		word_freqs.back().second += inv_word_count;
 	}
-	if (text.empty() || text[0] == '-' || !IsValidWord(text)) {
-		throw invalid_argument("invalid query!"s);
+	return word_freqs;
+}
+
+vector<pair<PostingIndex::TermId, uint32_t>> SearchServer::ComputeTermPositions(const vector<string_view>& words, const vector<uint32_t>& positions,
+	const vector<pair<string_view, double>>& word_freqs, const vector<PostingIndex::TermId>& word_terms) {
+	vector<pair<PostingIndex::TermId, uint32_t>> term_positions;
+	term_positions.reserve(words.size());
+	for (size_t i = 0; i < words.size(); ++i) {
+		const auto it = lower_bound(word_freqs.begin(), word_freqs.end(), words[i], [](const pair<string_view, double>& word_freq, string_view word) {
+			return word_freq.first < word;
+		});
+		term_positions.push_back({ word_terms[it - word_freqs.begin()], positions[i] });
 	}
-	return QueryWord{ text, is_minus, IsStopWord(text) };
+	sort(term_positions.begin(), term_positions.end());
+	return term_positions;
+}
+
+void SearchServer::ExpandPrefix(const string_view prefix, vector<PostingIndex::TermId>& term_ids) const {
+	prefix_terms_.FindFrequentTerms(prefix, MAX_PREFIX_EXPANSIONS, [this](PostingIndex::TermId term_id) {
+		return index_.GetPostings(term_id).GetDocumentFreq();
+	}, term_ids);
+}
+
+void SearchServer::ParseQueryWords(const string_view text, vector<string_view>& words, vector<QueryWord>& query_words) const {
+	::ParseQueryWords(text, [this](string_view word) {
+		return IsStopWord(word);
+	}, words, query_words);
 }
 
 SearchServer::Query SearchServer::ParseQuery(const string_view text_sv) const {
 	Query q;
 
-	std::vector<std::string_view> split = SplitIntoWords(text_sv);
+	std::vector<std::string_view> split;
+	std::vector<QueryWord> query_words;
+	ParseQueryWords(text_sv, split, query_words);
 
 	q.minus_words.reserve(split.size());
 	q.plus_words.reserve(split.size());
-	for (string_view word : split) {
-		QueryWord query_word = ParseQueryWord(word);
-		if (!query_word.is_stop) {
+	vector<PostingIndex::TermId> expansions;
+	for (const QueryWord& query_word : query_words) {
+		if (query_word.is_prefix) {
+			expansions.clear();
+			ExpandPrefix(query_word.data, expansions);
+			for (const PostingIndex::TermId term_id : expansions) {
+				(query_word.is_minus ? q.minus_words : q.plus_words).push_back(index_.GetTerm(term_id));
+			}
+		}
+		else if (!query_word.is_stop) {
 			if (query_word.is_minus) {
-				q.minus_words.push_back(move(query_word.data));
+				q.minus_words.push_back(query_word.data);
 			}
 			else {
-				q.plus_words.push_back(move(query_word.data));
+				q.plus_words.push_back(query_word.data);
+			}
+			if (query_word.phrase != QueryWord::NO_PHRASE) {
+				q.phrase_words.push_back(query_word);
 			}
 		}
 	}
@@ -149,47 +643,255 @@ SearchServer::Query SearchServer::ParseQuery(const string_view text_sv) const {
 	return q;
 }
 
+void SearchServer::ParseQuery(const string_view text, QueryContext& context) const {
+	context.plus_terms_.clear();
+	context.minus_terms_.clear();
+	context.phrase_terms_.clear();
+	ParseQueryWords(text, context.words_, context.query_words_);
+	for (const QueryWord& query_word : context.query_words_) {
+		if (query_word.is_stop) {
+			continue;
+		}
+		if (query_word.is_prefix) {
+			ExpandPrefix(query_word.data, query_word.is_minus ? context.minus_terms_ : context.plus_terms_);
+			continue;
+		}
+		const PostingIndex::TermId term_id = index_.FindTermId(query_word.data);
+		if (query_word.phrase != QueryWord::NO_PHRASE) {
+			context.phrase_terms_.push_back({ query_word.phrase, term_id, query_word.phrase_offset });
+		}
+		if (term_id != TermDictionary::NO_TERM) {
+			(query_word.is_minus ? context.minus_terms_ : context.plus_terms_).push_back(term_id);
+		}
+	}
+	for (auto* terms : { &context.plus_terms_, &context.minus_terms_ }) {
+		sort(terms->begin(), terms->end());
+		terms->erase(unique(terms->begin(), terms->end()), terms->end());
+	}
+}
+
+SearchServer::QueryContext& SearchServer::GetThreadQueryContext() {
+	thread_local QueryContext context;
+	return context;
+}
+
 bool SearchServer::IsStopWord(const string_view word) const {
 	return stop_words_sv_.count(word) > 0;
 }
 
 bool SearchServer::IsValidWord(const std::string_view word) {
-	return none_of(word.begin(), word.end(), [](char c) {
-		return c >= '\0' && c < ' ';
-		});
+	return IsValidText(word);
 }
 //--------------------------------------------------------------------------------
 
-double SearchServer::ComputeWordInverseDocumentFreq(string_view word) const {
-	return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+bool SearchServer::ContainsPhrase(int ordinal, const PhraseTerm* first, const PhraseTerm* last, vector<TermPositions>& term_positions) const {
+	const size_t term_count = last - first;
+	if (term_positions.size() < term_count) {
+		term_positions.resize(term_count);
+	}
+	for (size_t i = 0; i < term_count; ++i) {
+		TermPositions& term = term_positions[i];
+		term.cursor = 0;
+		if (first[i].term_id == TermDictionary::NO_TERM || !positions_->GetPositions(ordinal, first[i].term_id, term.positions)) {
+			return false;
+		}
+	}
+	// Every occurrence of the first term starts a candidate; the other terms are galloped to their
+	// offsets from it, and since candidates only move forward, so do their cursors.
+	for (const uint32_t start : term_positions[0].positions) {
+		size_t i = 1;
+		for (; i < term_count; ++i) {
+			TermPositions& term = term_positions[i];
+			const uint32_t position = start + first[i].offset;
+			term.cursor = Gallop(term.positions, term.cursor, position);
+			if (term.cursor == term.positions.size()) {
+				return false;
+			}
+			if (term.positions[term.cursor] != position) {
+				break;
+			}
+		}
+		if (i == term_count) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SearchServer::ContainsPhrases(int ordinal, const Query& query) const {
+	if (query.phrase_words.empty()) {
+		return true;
+	}
+	if (!positions_) {
+		throw logic_error("phrase queries need positions"s);
+	}
+	vector<PhraseTerm> phrase_terms;
+	for (const QueryWord& word : query.phrase_words) {
+		phrase_terms.push_back({ word.phrase, index_.FindTermId(word.data), word.phrase_offset });
+	}
+	vector<TermPositions> term_positions;
+	for (size_t first = 0, last = 0; first < phrase_terms.size(); first = last) {
+		while (last < phrase_terms.size() && phrase_terms[last].phrase == phrase_terms[first].phrase) {
+			++last;
+		}
+		if (!ContainsPhrase(ordinal, phrase_terms.data() + first, phrase_terms.data() + last, term_positions)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+const DocumentBitmap* SearchServer::GetPhraseDocuments(QueryContext& context) const {
+	const vector<PhraseTerm>& phrase_terms = context.phrase_terms_;
+	if (phrase_terms.empty()) {
+		return nullptr;
+	}
+	if (!positions_) {
+		throw logic_error("phrase queries need positions"s);
+	}
+	DocumentBitmap& phrase_documents = context.phrase_documents_;
+	phrase_documents.Clear();
+	for (size_t first = 0, last = 0; first < phrase_terms.size(); first = last) {
+		while (last < phrase_terms.size() && phrase_terms[last].phrase == phrase_terms[first].phrase) {
+			++last;
+		}
+		vector<PostingCursor>& cursors = context.phrase_cursors_;
+		cursors.clear();
+		for (size_t i = first; i < last; ++i) {
+			if (phrase_terms[i].term_id == TermDictionary::NO_TERM) {
+				phrase_documents.Clear();
+				return &phrase_documents;
+			}
+			cursors.emplace_back(&index_.GetPostings(phrase_terms[i].term_id));
+		}
+		sort(cursors.begin(), cursors.end(), [](const PostingCursor& lhs, const PostingCursor& rhs) {
+			return lhs.postings->Size() < rhs.postings->Size();
+		});
+
+		// The documents with every term of the phrase are found by galloping through the other posting lists
+		// from the shortest one; a list that jumps past the current document moves the shortest one after it.
+		DocumentBitmap& matches = first == 0 ? phrase_documents : context.phrase_matches_;
+		matches.Clear();
+		PostingCursor& driver = cursors.front();
+		while (driver.ordinal != PostingCursor::NO_ORDINAL) {
+			const int ordinal = driver.GetOrdinal();
+			int next_ordinal = ordinal;
+			for (size_t i = 1; i < cursors.size() && next_ordinal == ordinal; ++i) {
+				cursors[i].SeekTo(ordinal);
+				next_ordinal = cursors[i].GetOrdinal();
+			}
+			if (next_ordinal != ordinal) {
+				driver.SeekTo(next_ordinal);
+				continue;
+			}
+			if (!tombstones_[ordinal] && ContainsPhrase(ordinal, phrase_terms.data() + first, phrase_terms.data() + last, context.term_positions_)) {
+				matches.Add(ordinal);
+			}
+			driver.Next();
+		}
+		if (first > 0) {
+			phrase_documents.IntersectWith(matches);
+		}
+	}
+	return &phrase_documents;
 }
 
-std::set<int>::iterator SearchServer::begin() {
+const DocumentBitmap* SearchServer::GetExcludedDocuments(QueryContext& context) const {
+	const DocumentBitmap* excluded = nullptr;
+	for (const PostingIndex::TermId term_id : context.minus_terms_) {
+		const DocumentBitmap& documents = index_.GetPostings(term_id).documents;
+		if (documents.Empty()) {
+			continue;
+		}
+		if (excluded == nullptr) {
+			excluded = &documents;
+			continue;
+		}
+		if (excluded != &context.excluded_) {
+			context.excluded_ = *excluded;
+			excluded = &context.excluded_;
+		}
+		context.excluded_.UnionWith(documents);
+	}
+	return excluded;
+}
+
+bool SearchServer::IsExcluded(const QueryContext& context, int ordinal) const {
+	for (const PostingIndex::TermId term_id : context.minus_terms_) {
+		if (index_.GetPostings(term_id).documents.Contains(ordinal)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+SearchServer::PostingCursor::PostingCursor(const PostingList* postings, double weight, double max_score)
+	: postings(postings)
+	, weight(weight)
+	, max_score(max_score)
+	, ordinal(postings->Empty() ? NO_ORDINAL : postings->document_ids[0]) {
+}
+
+int SearchServer::PostingCursor::GetOrdinal() const {
+	return ordinal;
+}
+
+void SearchServer::PostingCursor::Next() {
+	++position;
+	ordinal = position < postings->Size() ? postings->document_ids[position] : NO_ORDINAL;
+}
+
+void SearchServer::PostingCursor::SeekTo(int target) {
+	if (target <= ordinal) {
+		return;
+	}
+	position = postings->Seek(position, target);
+	ordinal = position < postings->Size() ? postings->document_ids[position] : NO_ORDINAL;
+}
+
+std::set<int>::const_iterator SearchServer::begin() const {
 	return document_ids_.begin();
 }
 
-std::set<int>::iterator SearchServer::end() {
+std::set<int>::const_iterator SearchServer::end() const {
 	return document_ids_.end();
 }
 
 const std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
-	auto it = id_to_words_freqs_.find(document_id);
-	std::map<std::string_view, double> res;
-	if (it != id_to_words_freqs_.end()) {
-		for (auto a = (*it).second.begin(); a != (*it).second.end(); ++a) {
-			res.insert(*a);
-		}
+	const int ordinal = FindOrdinal(document_id);
+	if (ordinal < 0) {
+		return {};
+	}
+	std::map<std::string_view, double> word_freqs;
+	for (const auto [term_id, freq] : documents_words_freqs_[ordinal]) {
+		word_freqs.emplace(index_.GetTerm(term_id), freq);
 	}
-	return res;
+	return word_freqs;
+}
+
+SearchServer::DocumentTerms SearchServer::GetDocumentTerms(int document_id) const {
+	const int ordinal = FindOrdinal(document_id);
+	if (ordinal < 0) {
+		return {};
+	}
+	const auto& document_words = documents_words_freqs_[ordinal];
+	return { document_words.begin(), document_words.end() };
+}
+
+string_view SearchServer::GetTerm(PostingIndex::TermId term_id) const {
+	return index_.GetTerm(term_id);
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-	for (auto [word, freq] : GetWordFrequencies(document_id)) {
-		word_to_document_freqs_.at(word).erase(document_id);
+	const int ordinal = FindOrdinal(document_id);
+	if (ordinal < 0) {
+		return;
 	}
-	id_to_words_freqs_.erase(document_id);
-	document_ids_.erase(document_id);
-	documents_.erase(document_id);
+	for (const auto [term_id, freq] : documents_words_freqs_[ordinal]) {
+		index_.RemovePosting(term_id, ordinal);
+	}
+	ReleaseOrdinal(ordinal);
+	UpdateDocumentCount();
 }
 
 void SearchServer::RemoveDocument(const execution::sequenced_policy&,
@@ -200,24 +902,108 @@ void SearchServer::RemoveDocument(const execution::sequenced_policy&,
  void SearchServer::RemoveDocument(const execution::parallel_policy&,
 	 int document_id) {
 
-		 auto temp = GetWordFrequencies(document_id);
-	std::vector<std::pair<std::string_view, double>> words_of_doc(temp.begin(),
-	temp.end());
-
-	mutex m;
+	const int ordinal = FindOrdinal(document_id);
+	if (ordinal < 0) {
+		return;
+	}
+	const auto& words_of_doc = documents_words_freqs_[ordinal];
 
+	// Every term has its own posting list, so no lock is needed.
 	for_each(
 		execution::par,
  words_of_doc.begin(),
  words_of_doc.end(),
-[&](auto& word) mutable {
-			lock_guard<mutex> l(m);
-			word_to_document_freqs_.at(word.first).erase(document_id); 
+[&](const TermFrequency& word) {
+			index_.RemovePosting(word.term_id, ordinal);
 		}
 );
 
-	 id_to_words_freqs_.erase(document_id);
-	 document_ids_.erase(document_id);
-	 documents_.erase(document_id);
+	 ReleaseOrdinal(ordinal);
+	 UpdateDocumentCount();
  }
 
+void SearchServer::RemoveDocuments(const vector<int>& document_ids) {
+	const size_t first_removed = tombstoned_ordinals_.size();
+	for (const int document_id : document_ids) {
+		const auto it = id_to_ordinal_.find(document_id);
+		if (it == id_to_ordinal_.end()) {
+			continue;
+		}
+		const int ordinal = it->second;
+		id_to_ordinal_.erase(it);
+		document_ids_.erase(document_id);
+		total_word_count_ -= documents_[ordinal].word_count;
+		tombstones_[ordinal] = true;
+		tombstoned_ordinals_.push_back(ordinal);
+	}
+
+	// Deletions are grouped by term, so that every posting list is updated once and by one thread.
+	vector<uint32_t> deleted_counts(index_.GetTermCount());
+	vector<PostingIndex::TermId> touched_terms;
+	for (size_t i = first_removed; i < tombstoned_ordinals_.size(); ++i) {
+		for (const auto& [term_id, freq] : documents_words_freqs_[tombstoned_ordinals_[i]]) {
+			if (deleted_counts[term_id]++ == 0) {
+				touched_terms.push_back(term_id);
+			}
+		}
+	}
+	for_each(execution::par, touched_terms.begin(), touched_terms.end(), [&](PostingIndex::TermId term_id) {
+		index_.MarkDeleted(term_id, deleted_counts[term_id]);
+	});
+	UpdateDocumentCount();
+
+	if (tombstoned_ordinals_.size() * COMPACTION_RATIO > documents_.size()) {
+		CompactIndex();
+	}
+}
+
+void SearchServer::CompactIndex() {
+	vector<bool> is_touched(index_.GetTermCount());
+	vector<PostingIndex::TermId> touched_terms;
+	for (const int ordinal : tombstoned_ordinals_) {
+		for (const auto& [term_id, freq] : documents_words_freqs_[ordinal]) {
+			if (!is_touched[term_id]) {
+				is_touched[term_id] = true;
+				touched_terms.push_back(term_id);
+			}
+		}
+	}
+	for_each(execution::par, touched_terms.begin(), touched_terms.end(), [&](PostingIndex::TermId term_id) {
+		index_.PurgeDeleted(term_id, tombstones_);
+	});
+
+	for (const int ordinal : tombstoned_ordinals_) {
+		tombstones_[ordinal] = false;
+		documents_words_freqs_[ordinal] = {};
+		if (positions_) {
+			positions_->ClearDocument(ordinal);
+		}
+		free_ordinals_.push_back(ordinal);
+	}
+	tombstoned_ordinals_.clear();
+}
+
+void SearchServer::QueryContext::ResetAccumulators(size_t document_count) {
+	for (const int ordinal : matched_ordinals_) {
+		relevances_[ordinal] = 0;
+		is_matched_[ordinal] = false;
+	}
+	matched_ordinals_.clear();
+	if (relevances_.size() < document_count) {
+		relevances_.resize(document_count);
+		is_matched_.resize(document_count);
+	}
+}
+
+SearchServer::QueryContext::Usage::Usage(QueryContext& context)
+	: context_(context)
+{
+	if (context_.is_busy_) {
+		throw logic_error("query context is already in use"s);
+	}
+	context_.is_busy_ = true;
+}
+
+SearchServer::QueryContext::Usage::~Usage() {
+	context_.is_busy_ = false;
+}
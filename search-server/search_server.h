@@ -10,18 +10,70 @@
 #include <algorithm>
 #include <execution>
 #include <iterator>
+#include <limits>
 #include <type_traits>
 #include <string_view>
 #include <cassert>
-#include "concurrent_map.h"
-const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double eps = 1e-6;
+#include <unordered_map>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include "concurrent_accumulator.h"
+#include "paginator.h"
+#include "posting_index.h"
+#include "positional_index.h"
+#include "prefix_term_index.h"
+#include "query_parser.h"
+#include "scoring.h"
+#include "snapshot.h"
+#include "top_documents.h"
+
+struct IndexMemoryUsage {
+	size_t term_count = 0;
+	size_t posting_count = 0;
+	size_t posting_list_bytes = 0;
+	size_t term_dictionary_bytes = 0;
+	size_t document_terms_bytes = 0;
+	size_t position_bytes = 0;
+	size_t prefix_index_bytes = 0;
+};
+
+struct NewDocument {
+	int id;
+	std::string_view text;
+	DocumentStatus status;
+	std::vector<int> ratings;
+};
+
+enum class IdfUpdatePolicy {
+	EAGER,
+	DEFERRED,
+};
+
+namespace search_mode {
+	// Document-at-a-time evaluation with WAND early termination. A query whose score bounds are too loose
+	// to skip postings falls back to term-at-a-time scoring for the documents not evaluated yet.
+	struct wand_policy {};
+	inline constexpr wand_policy wand{};
+
+	// Parallel evaluation of one query: the ordinal space is cut into ranges that are scored
+	// on separate threads with private accumulators and top documents, which are merged at the end.
+	struct partitioned_policy {};
+	inline constexpr partitioned_policy partitioned{};
+}
 
 class SearchServer {
 
 	using DocText = std::vector<std::string_view>;
 
 public:
+	struct TermFrequency {
+		PostingIndex::TermId term_id;
+		double freq;
+	};
+	using DocumentTerms = IteratorRange<std::vector<TermFrequency>::const_iterator>;
+	class QueryContext;
 
 	template <typename StringContainer>
 	explicit SearchServer(const StringContainer& stop_words);
@@ -31,85 +83,308 @@ public:
 	explicit SearchServer(std::string_view stop_words_text);
 
 	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
-
-	template <typename DocumentPredicate>
-	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
-	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+	// Tokenizes the batch and merges the postings of every term into the index on all cores; words are
+	// interned sequentially, so on a single core the batch is no faster than a loop of AddDocument.
+	// The whole batch is validated first, so an invalid document leaves the server unchanged.
+	void AddDocuments(const std::vector<NewDocument>& documents);
+
+	// The relevance function is the first template argument, e.g. FindTopDocuments<scoring::Bm25>(raw_query);
+	// see scoring.h.
+	template <typename Scoring = scoring::TfIdf, typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename Scoring = scoring::TfIdf>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename Scoring = scoring::TfIdf>
 	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
-	template <typename ExecutionPolicy, typename DocumentPredicate>
-	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
-	template <typename ExecutionPolicy>
-	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const;
-	template <typename ExecutionPolicy>
+	template <typename Scoring = scoring::TfIdf, typename ExecutionPolicy, typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename Scoring = scoring::TfIdf, typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename Scoring = scoring::TfIdf, typename ExecutionPolicy>
 	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const;
 
+	// Queries that reuse the scratch memory of the context; the overloads above use a context kept by the calling thread.
+	template <typename Scoring = scoring::TfIdf, typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(QueryContext& context, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename Scoring = scoring::TfIdf>
+	std::vector<Document> FindTopDocuments(QueryContext& context, std::string_view raw_query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename Scoring = scoring::TfIdf>
+	std::vector<Document> FindTopDocuments(QueryContext& context, std::string_view raw_query) const;
+
+	template <typename Scoring = scoring::TfIdf, typename ExecutionPolicy, typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, QueryContext& context, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename Scoring = scoring::TfIdf, typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, QueryContext& context, std::string_view raw_query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename Scoring = scoring::TfIdf, typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, QueryContext& context, std::string_view raw_query) const;
+
+	// Append the documents found to results instead of returning them; a caller that reuses both the context
+	// and the vector runs queries without allocating.
+	template <typename Scoring = scoring::TfIdf, typename ExecutionPolicy, typename DocumentPredicate>
+	void FindTopDocuments(const ExecutionPolicy& policy, QueryContext& context, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count, std::vector<Document>& results) const;
+	template <typename Scoring = scoring::TfIdf>
+	void FindTopDocuments(QueryContext& context, std::string_view raw_query, DocumentStatus status, size_t max_result_count, std::vector<Document>& results) const;
+
 	int GetDocumentCount() const;
+	// Changes with every modification that can change query results.
+	uint64_t GetGeneration() const;
+	// Canonical text of the query: its distinct plus and minus words that occur in the index.
+	// Queries with the same normalized text have the same results within one generation.
+	std::string NormalizeQuery(std::string_view raw_query) const;
+
+	// A query word ending with an asterisk, such as cat*, stands for the indexed terms that start with it,
+	// up to this many of them with the largest document frequencies. Every expanded term is scored as
+	// a word of its own; a minus word expands the same way.
+	static constexpr size_t MAX_PREFIX_EXPANSIONS = ::MAX_PREFIX_EXPANSIONS;
+
+	// Starts keeping the positions of words, which queries with "quoted phrases" need: the words of
+	// a phrase must follow each other in a document. Positions cost memory for every posting, and only
+	// a server without documents can enable them, since the texts of indexed documents are not kept.
+	void EnablePositions();
+	bool HasPositions() const;
+
+	// DEFERRED skips IDF maintenance during bulk loads; switching back to EAGER recomputes all IDFs once.
+	void SetIdfUpdatePolicy(IdfUpdatePolicy policy);
+	void RecomputeInverseDocumentFreqs();
+
+	// Compares the posting lists with their block-compressed form; compresses every list, so it is not cheap.
+	IndexMemoryUsage GetIndexMemoryUsage() const;
+
+	// Binary snapshot of the whole index. A loaded server keeps the file mapped and refers to its terms in place.
+	void SaveSnapshot(const std::string& path) const;
+	static SearchServer LoadSnapshot(const std::string& path);
 
 	std::tuple<DocText, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
 
 	template< class ExecutionPolicy>
 	std::tuple<DocText, DocumentStatus> MatchDocument(ExecutionPolicy&& policy, std::string_view raw_query, int document_id) const;
 
-	std::set<int>::iterator begin();
+	std::set<int>::const_iterator begin() const;
 
-	std::set<int>::iterator end();
+	std::set<int>::const_iterator end() const;
 
 	const std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+	// Non-allocating view of the document's terms sorted by term id; empty for an unknown id.
+	// Valid until the document is removed or the server is modified.
+	DocumentTerms GetDocumentTerms(int document_id) const;
+	std::string_view GetTerm(PostingIndex::TermId term_id) const;
 
 	void RemoveDocument(int document_id);
 	void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
 	void RemoveDocument(const std::execution::parallel_policy&, int document_id);
+	// Removes a batch lazily: the documents leave the results at once, while their postings are tombstoned
+	// and purged by CompactIndex, which runs by itself once more than one ordinal in COMPACTION_RATIO is tombstoned.
+	void RemoveDocuments(const std::vector<int>& document_ids);
+	void CompactIndex();
+	// Tombstones slow every query that reaches their postings, and a compaction rewrites the whole index,
+	// so it waits until a quarter of the ordinals are dead.
+	static constexpr size_t COMPACTION_RATIO = 4;
 
 private:
 	struct DocumentData {
+		int id;
 		int rating;
 		DocumentStatus status;
-		std::set<std::string> words;
+		int word_count;
 	};
 	const std::set<std::string> stop_words_;
 	std::set<std::string_view> stop_words_sv_;
-	std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-	std::map<int, DocumentData> documents_;
+	// Postings, metadata and word frequencies are indexed by a dense internal ordinal.
+	// External document ids are translated only at the API boundary.
+	PostingIndex index_;
+	IdfUpdatePolicy idf_update_policy_ = IdfUpdatePolicy::EAGER;
+	// Document count and average length as of the last IDF update, so that they follow the IDF update policy.
+	scoring::CollectionStatistics collection_{};
+	uint64_t total_word_count_ = 0;
+	uint64_t generation_ = 0;
+	std::vector<DocumentData> documents_;
+	// Terms of every document sorted by term id.
+	std::vector<std::vector<TermFrequency>> documents_words_freqs_;
+	std::vector<int> free_ordinals_;
+	// Ordinals of removed documents whose postings are not purged yet; they are recycled only after compaction.
+	std::vector<bool> tombstones_;
+	std::vector<int> tombstoned_ordinals_;
+	std::unordered_map<int, int> id_to_ordinal_;
 	std::set<int> document_ids_;
-	std::map<int, std::map<std::string_view, double>> id_to_words_freqs_;
+	std::shared_ptr<const MappedFile> snapshot_file_;
+	std::optional<PositionalIndex> positions_;
+	PrefixTermIndex prefix_terms_;
 
-	std::vector<std::string> SplitIntoWordsNoStop(std::string_view text) const;
+	SearchServer(SnapshotReader& reader, std::shared_ptr<const MappedFile> snapshot_file);
+	static std::vector<std::string_view> ReadStopWords(SnapshotReader& reader);
 
-	static int ComputeAverageRating(const std::vector<int>& ratings);
+	std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+	// Returns false instead of throwing on an invalid word, for use inside parallel algorithms.
+	bool SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const;
+	// Also appends the position of every kept word among all words of the text.
+	bool SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words, std::vector<uint32_t>& positions) const;
+	// Distinct words of a document sorted by word, with their term frequencies.
+	static std::vector<std::pair<std::string_view, double>> ComputeWordFreqs(std::vector<std::string_view> words);
 
-	struct QueryWord {
-		std::string_view data;
-		bool is_minus;
-		bool is_stop;
-	};
+	// Pairs of a term id and a position for every word, sorted; word_terms are the terms of word_freqs.
+	static std::vector<std::pair<PostingIndex::TermId, uint32_t>> ComputeTermPositions(const std::vector<std::string_view>& words, const std::vector<uint32_t>& positions,
+		const std::vector<std::pair<std::string_view, double>>& word_freqs, const std::vector<PostingIndex::TermId>& word_terms);
+
+
+	void UpdateDocumentCount();
+
+	int FindOrdinal(int document_id) const;
+	// Returns TermDictionary::NO_TERM if the document does not contain the word.
+	PostingIndex::TermId FindDocumentTerm(int ordinal, std::string_view word) const;
+	int AllocateOrdinal(DocumentData document_data);
+	void ReleaseOrdinal(int ordinal);
 
 	struct Query {
 		std::vector<std::string_view> plus_words;
 		std::vector<std::string_view> minus_words;
+		// Words of the phrases, which are plus words as well.
+		std::vector<QueryWord> phrase_words;
+	};
+
+	struct PhraseTerm {
+		int phrase;
+		// TermDictionary::NO_TERM for a word missing from the index, so that the phrase matches nothing.
+		PostingIndex::TermId term_id;
+		uint32_t offset;
+	};
+
+	struct TermPositions {
+		std::vector<uint32_t> positions;
+		size_t cursor;
 	};
 
+	// Splits the query into words and resolves the quotes of phrases.
+	void ParseQueryWords(std::string_view text, std::vector<std::string_view>& words, std::vector<QueryWord>& query_words) const;
 	Query ParseQuery(std::string_view text) const;
+	// Fills the distinct plus and minus terms of the context; words missing from the index are dropped.
+	void ParseQuery(std::string_view text, QueryContext& context) const;
+	static QueryContext& GetThreadQueryContext();
 
-	QueryWord ParseQueryWord(std::string_view text) const;
+	// Appends the terms of live documents that start with prefix, capped at MAX_PREFIX_EXPANSIONS.
+	void ExpandPrefix(std::string_view prefix, std::vector<PostingIndex::TermId>& term_ids) const;
 
 	bool IsStopWord(std::string_view word) const;
 
 	static bool IsValidWord(std::string_view word);
 
-	double ComputeWordInverseDocumentFreq(std::string_view word) const;
+	void UpdateCollectionStatistics();
 
-	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+	// Predicate of the status overloads. The query loops recognize it and compare the status tags
+	// of the postings instead of looking up every document.
+	struct StatusFilter {
+		DocumentStatus status;
 
-	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, DocumentPredicate document_predicate) const;
+		bool operator()(int document_id, DocumentStatus document_status, int rating) const {
+			return document_status == status;
+		}
+	};
 
+	// Whether the terms of one phrase, in the order of their offsets, follow each other in the document.
+	bool ContainsPhrase(int ordinal, const PhraseTerm* first, const PhraseTerm* last, std::vector<TermPositions>& term_positions) const;
+	bool ContainsPhrases(int ordinal, const Query& query) const;
+	// Documents containing every phrase of the context, or nullptr if the query has none.
+	const DocumentBitmap* GetPhraseDocuments(QueryContext& context) const;
+
+	// Documents containing any minus term of the context, or nullptr if the query has none, for
+	// point lookups; several minus terms are united into the bitmap of the context.
+	const DocumentBitmap* GetExcludedDocuments(QueryContext& context) const;
+	// Whether the document contains a minus term of the context, looked up in each bitmap without uniting them.
+	bool IsExcluded(const QueryContext& context, int ordinal) const;
+
+	// Whether the document of the posting at the position is live and passes the predicate.
 	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query, DocumentPredicate document_predicate) const;
+	bool IsAccepted(const PostingList& postings, size_t position, DocumentPredicate& document_predicate) const;
+
+	template <typename Scoring, typename DocumentPredicate>
+	std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, QueryContext& context, DocumentPredicate document_predicate) const;
+
+	template <typename Scoring, typename DocumentPredicate>
+	void CollectTopDocuments(const std::execution::sequenced_policy&, QueryContext& context, DocumentPredicate document_predicate, size_t max_result_count, std::vector<Document>& results) const;
+
+	template <typename Scoring, typename DocumentPredicate>
+	void CollectTopDocuments(const std::execution::parallel_policy&, QueryContext& context, DocumentPredicate document_predicate, size_t max_result_count, std::vector<Document>& results) const;
+
+	template <typename Scoring, typename DocumentPredicate>
+	void CollectTopDocuments(const search_mode::wand_policy&, QueryContext& context, DocumentPredicate document_predicate, size_t max_result_count, std::vector<Document>& results) const;
+
+	// A WAND step with n cursors costs about as much as scoring (n + 2) / 2 postings term at a time, so the
+	// mode falls back once its steps pass fewer postings on average. Steps are counted from the moment the
+	// result is full, since until then every step scores a document; the check runs every WAND_CHECK_INTERVAL steps.
+	static constexpr size_t WAND_CHECK_INTERVAL = 256;
+
+	// Smallest range of ordinals that is worth a task of its own in the partitioned mode.
+	static constexpr size_t MIN_PARTITION_SIZE = 1024;
+
+	template <typename Scoring, typename DocumentPredicate>
+	void CollectTopDocuments(const search_mode::partitioned_policy&, QueryContext& context, DocumentPredicate document_predicate, size_t max_result_count, std::vector<Document>& results) const;
+
+	struct PostingCursor {
+		const PostingList* postings;
+		size_t position = 0;
+		// Weight of the term under the scoring of the query.
+		double weight = 0;
+		double max_score = 0;
+		// Ordinal at the position, or NO_ORDINAL past the end.
+		int ordinal;
+
+		static constexpr int NO_ORDINAL = std::numeric_limits<int>::max();
+
+		explicit PostingCursor(const PostingList* postings, double weight = 0, double max_score = 0);
+		int GetOrdinal() const;
+		void Next();
+		void SeekTo(int ordinal);
+	};
+
+	static void SelectTopDocuments(const std::execution::parallel_policy&, std::vector<Document>& documents, size_t max_count);
 
 };
 
+// Parsed terms and scratch buffers of a query. The buffers keep their capacity between queries,
+// so a context reused for many queries stops allocating; the dense accumulators grow to the number
+// of document ordinals and are cleared sparsely. A context may serve one query at a time.
+class SearchServer::QueryContext {
+private:
+	friend class SearchServer;
+
+	std::vector<std::string_view> words_;
+	std::vector<QueryWord> query_words_;
+	std::vector<PostingIndex::TermId> plus_terms_;
+	std::vector<PostingIndex::TermId> minus_terms_;
+	// Sorted by phrase and offset.
+	std::vector<PhraseTerm> phrase_terms_;
+	// Indexed by ordinal; only the matched ordinals of the last query are nonzero.
+	std::vector<double> relevances_;
+	std::vector<bool> is_matched_;
+	std::vector<int> matched_ordinals_;
+	// 0, 1, 2, ... up to the longest posting list walked by a parallel query.
+	std::vector<size_t> positions_;
+	std::vector<PostingCursor> cursors_;
+	std::vector<uint32_t> cursor_order_;
+	DocumentBitmap excluded_;
+	std::vector<PostingCursor> phrase_cursors_;
+	std::vector<TermPositions> term_positions_;
+	DocumentBitmap phrase_documents_;
+	DocumentBitmap phrase_matches_;
+	TopDocumentsCollector top_{ MAX_RESULT_DOCUMENT_COUNT };
+	bool is_busy_ = false;
+
+	// Clears what the last query left in the accumulators and sizes them for document_count ordinals.
+	void ResetAccumulators(size_t document_count);
+
+	class Usage {
+	public:
+		explicit Usage(QueryContext& context);
+		~Usage();
+
+		Usage(const Usage&) = delete;
+		Usage& operator=(const Usage&) = delete;
+
+	private:
+		QueryContext& context_;
+	};
+};
+
 template <typename StringContainer>
  SearchServer::SearchServer(const StringContainer& stop_words)
 	: stop_words_(MakeUniqueNonEmptyStrings(stop_words)) {
@@ -120,131 +395,149 @@ template <typename StringContainer>
 	}
 }
 
+ template <typename Scoring, typename DocumentPredicate>
+ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count) const {
+	 return FindTopDocuments<Scoring>(std::execution::seq, raw_query, document_predicate, max_result_count);
+ }
+
+ template <typename Scoring>
+ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count) const {
+	 return FindTopDocuments<Scoring>(raw_query, StatusFilter{ status }, max_result_count);
+ }
+
+ template <typename Scoring>
+ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
+	 return FindTopDocuments<Scoring>(raw_query, DocumentStatus::ACTUAL);
+ }
+
+ template <typename Scoring, typename DocumentPredicate>
+ std::vector<Document> SearchServer::FindTopDocuments(QueryContext& context, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count) const {
+	 return FindTopDocuments<Scoring>(std::execution::seq, context, raw_query, document_predicate, max_result_count);
+ }
+
+ template <typename Scoring>
+ std::vector<Document> SearchServer::FindTopDocuments(QueryContext& context, std::string_view raw_query, DocumentStatus status, size_t max_result_count) const {
+	 return FindTopDocuments<Scoring>(std::execution::seq, context, raw_query, status, max_result_count);
+ }
+
+ template <typename Scoring>
+ std::vector<Document> SearchServer::FindTopDocuments(QueryContext& context, std::string_view raw_query) const {
+	 return FindTopDocuments<Scoring>(context, raw_query, DocumentStatus::ACTUAL);
+ }
+
  template <typename DocumentPredicate>
- std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
-	 Query query = ParseQuery(raw_query);
-	 auto matched_documents = FindAllDocuments(query, document_predicate);
+ bool SearchServer::IsAccepted(const PostingList& postings, size_t position, DocumentPredicate& document_predicate) const {
+	 const int ordinal = postings.document_ids[position];
+	 if (tombstones_[ordinal]) {
+		 return false;
+	 }
+	 if constexpr (std::is_same_v<DocumentPredicate, StatusFilter>) {
+		 return postings.tags[position] == static_cast<uint8_t>(document_predicate.status);
+	 }
+	 else {
+		 const DocumentData& document_data = documents_[ordinal];
+		 return document_predicate(document_data.id, document_data.status, document_data.rating);
+	 }
+ }
 
-	 sort(matched_documents.begin(), matched_documents.end(), [](const Document & lhs, const Document & rhs) {
-		 if (std::abs(lhs.relevance - rhs.relevance) < eps) {
-			 return lhs.rating > rhs.rating;
+ template <typename Scoring, typename DocumentPredicate>
+ void SearchServer::CollectTopDocuments(const std::execution::sequenced_policy&, QueryContext& context, DocumentPredicate document_predicate, size_t max_result_count, std::vector<Document>& results) const {
+	 context.ResetAccumulators(documents_.size());
+	 std::vector<double>& document_to_relevance = context.relevances_;
+	 std::vector<bool>& is_matched = context.is_matched_;
+	 std::vector<int>& matched_ordinals = context.matched_ordinals_;
+
+	 for (const PostingIndex::TermId term_id : context.plus_terms_) {
+		 const PostingList& postings = index_.GetPostings(term_id);
+		 if (postings.GetDocumentFreq() == 0) {
+			 continue;
 		 }
-		 else {
-			 return lhs.relevance > rhs.relevance;
+		 const double weight = Scoring::ComputeTermWeight(postings, collection_);
+		 for (size_t i = 0; i < postings.Size(); ++i) {
+			 const int ordinal = postings.document_ids[i];
+			 if (IsAccepted(postings, i, document_predicate)) {
+				 if (!is_matched[ordinal]) {
+					 is_matched[ordinal] = true;
+					 matched_ordinals.push_back(ordinal);
+				 }
+				 document_to_relevance[ordinal] += Scoring::Score(weight, postings.term_freqs[i], documents_[ordinal].word_count, collection_);
+			 }
 		 }
+	 }
+
+	 for (const PostingIndex::TermId term_id : context.minus_terms_) {
+		 index_.GetPostings(term_id).documents.ForEach([&is_matched](uint32_t ordinal) {
+			 is_matched[ordinal] = false;
 		 });
-	 if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		 matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
 	 }
 
-	 return matched_documents;
+	 const DocumentBitmap* phrase_documents = GetPhraseDocuments(context);
+	 TopDocumentsCollector& top = context.top_;
+	 top.Reset(max_result_count);
+	 for (const int ordinal : matched_ordinals) {
+		 if (is_matched[ordinal] && (phrase_documents == nullptr || phrase_documents->Contains(ordinal))) {
+			 top.Add({ documents_[ordinal].id, document_to_relevance[ordinal], documents_[ordinal].rating });
+		 }
+	 }
+	 top.ExtractTo(results);
  }
 
- template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-
-	std::set<std::string_view> plus_words(std::make_move_iterator(query.plus_words.begin()), std::make_move_iterator(query.plus_words.end()));
-
-    for (std::string_view word : plus_words) {
-   	 if (word_to_document_freqs_.count(word) == 0) {
-   		 continue;
-   	 }
-   	 const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-   	 for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-   		 const auto& document_data = documents_.at(document_id);
-   		 if (document_predicate(document_id, document_data.status, document_data.rating)) {
-   			 document_to_relevance[document_id] += term_freq * inverse_document_freq;
-   		 }
-   	 }
-    }
-
-    for (std::string_view word : query.minus_words) {
-   	 if (word_to_document_freqs_.count(word) == 0) {
-   		 continue;
-   	 }
-   	 for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-   		 document_to_relevance.erase(document_id);
-   	 }
-    }
-
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-   	 matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
-    }
-    return matched_documents;
-}
-
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, DocumentPredicate document_predicate) const {
-	return FindAllDocuments(query, document_predicate);
-}
-
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&, const Query& query, DocumentPredicate document_predicate) const {
-	ConcurrentMap<int, double> document_to_relevance(7);
-
-	std::set<std::string_view> plus_words_raw(std::make_move_iterator(query.plus_words.begin()), std::make_move_iterator(query.plus_words.end()));
-	std::vector<std::string_view> plus_words(std::make_move_iterator(plus_words_raw.begin()), std::make_move_iterator(plus_words_raw.end()));
+template <typename Scoring, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&, QueryContext& context, DocumentPredicate document_predicate) const {
+	std::vector<const PostingList*> plus_postings;
+	size_t posting_count = 0;
+	for (const PostingIndex::TermId term_id : context.plus_terms_) {
+		const PostingList& postings = index_.GetPostings(term_id);
+		if (postings.GetDocumentFreq() > 0) {
+			plus_postings.push_back(&postings);
+			posting_count += postings.Size();
+		}
+	}
 
-	auto func = [&](std::string_view word) {
-		const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-		std::for_each(
-			std::execution::par,
-			word_to_document_freqs_.at(word).begin(),
-			word_to_document_freqs_.at(word).end(),
-			[&](const std::pair<int, double>& el) {
-				const auto& document_data = documents_.at(el.first);
-				if (document_predicate(el.first, document_data.status, document_data.rating)) {
-					document_to_relevance[el.first].ref_to_value += el.second * inverse_document_freq;
-				}
-			}
-		);
-	};
+	// Every matched document takes one key, however many of the postings point to it.
+	ConcurrentAccumulator<int, double> document_to_relevance(std::min(posting_count, documents_.size()));
 
-	std::for_each(
-		std::execution::par,
-		plus_words.begin(),
-		plus_words.end(),
-		[&](std::string_view word) {
-			if (word_to_document_freqs_.count(word) != 0) {
-				func(word);
-			}
+	// Parallel algorithms may pass copies of the elements, so postings are walked by position.
+	std::vector<size_t>& positions = context.positions_;
+	for (const PostingList* postings : plus_postings) {
+		while (positions.size() < postings->Size()) {
+			positions.push_back(positions.size());
 		}
-	);
+	}
 
-	auto eraser = [&](const std::string_view word) {
+	auto func = [&](const PostingList& postings) {
+		const double weight = Scoring::ComputeTermWeight(postings, collection_);
 		std::for_each(
 			std::execution::par,
-			word_to_document_freqs_.at(word).begin(),
-			word_to_document_freqs_.at(word).end(),
-			[&](const std::pair<int, double> el) {
-				document_to_relevance.Erase(el.first);
+			positions.begin(),
+			positions.begin() + postings.Size(),
+			[&](size_t position) {
+				const int ordinal = postings.document_ids[position];
+				if (IsAccepted(postings, position, document_predicate)) {
+					document_to_relevance.Add(ordinal, Scoring::Score(weight, postings.term_freqs[position], documents_[ordinal].word_count, collection_));
+				}
 			}
 		);
 	};
 
-	std::vector<std::string_view> minus_words(std::make_move_iterator(query.minus_words.begin()), std::make_move_iterator(query.minus_words.end()));
-
-
 	std::for_each(
 		std::execution::par,
-		minus_words.begin(),
-		minus_words.end(),
-		[&](std::string_view word) {
-			if (word_to_document_freqs_.count(word) != 0) {
-				eraser(word);
-			}
+		plus_postings.begin(),
+		plus_postings.end(),
+		[&](const PostingList* postings) {
+			func(*postings);
 		}
 	);
 
-	std::map<int, double> document_to_relevance_ordinary = document_to_relevance.BuildOrdinaryMap();
-
+	const DocumentBitmap* excluded = GetExcludedDocuments(context);
+	const DocumentBitmap* phrase_documents = GetPhraseDocuments(context);
 	std::vector<Document> matched_documents;
-	matched_documents.reserve(document_to_relevance_ordinary.size());
-	for (const auto [document_id, relevance] : document_to_relevance_ordinary) {
-		matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
-	}
+	document_to_relevance.ForEach([&](int ordinal, double relevance) {
+		if ((excluded != nullptr && excluded->Contains(ordinal)) || (phrase_documents != nullptr && !phrase_documents->Contains(ordinal))) {
+			return;
+		}
+		matched_documents.push_back({ documents_[ordinal].id, relevance, documents_[ordinal].rating });
+	});
 
 	return matched_documents;
 }
@@ -278,7 +571,8 @@ std::vector<Document> SearchServer::FindAllDocuments(const std::execution::paral
 	 
 	 using namespace std::literals;
 
-	 if (!document_ids_.count(document_id)) {
+	 const int ordinal = FindOrdinal(document_id);
+	 if (ordinal < 0) {
 		 throw std::out_of_range("Wrong Id!"s);
 	 }
 
@@ -286,8 +580,6 @@ std::vector<Document> SearchServer::FindAllDocuments(const std::execution::paral
 		 return MatchDocument(raw_query, document_id);
 	 }
 
-	 const std::map<std::string_view, double>* const words = &id_to_words_freqs_.at(document_id);
-
 	 Query query = ParseQuery(raw_query);
 	 
 	 std::vector<std::string_view> minus_words(query.minus_words.begin(), query.minus_words.end());
@@ -297,10 +589,13 @@ std::vector<Document> SearchServer::FindAllDocuments(const std::execution::paral
 			 minus_words.begin(),
 			 minus_words.end(),
 			 [&](std::string_view word) {
-				 return (*words).count(word);
+				 return FindDocumentTerm(ordinal, word) != TermDictionary::NO_TERM;
 			 }
 		 )) {
-			 return { {}, documents_.at(document_id).status };
+			 return { DocText{}, documents_[ordinal].status };
+		 }
+		 if (!ContainsPhrases(ordinal, query)) {
+			 return { DocText{}, documents_[ordinal].status };
 		 }
 
 
@@ -311,9 +606,9 @@ std::vector<Document> SearchServer::FindAllDocuments(const std::execution::paral
 		 query.plus_words.end(),
 		 matched_words.begin(),
 		 [&](std::string_view word) {
-			 auto it = (*words).find(word);
-			 if (it != (*words).end()) {
-				 return (*it).first;
+			 const PostingIndex::TermId term_id = FindDocumentTerm(ordinal, word);
+			 if (term_id != TermDictionary::NO_TERM) {
+				 return index_.GetTerm(term_id);
 			 }
 			 return ""sv;
 			 ; }
@@ -323,41 +618,276 @@ std::vector<Document> SearchServer::FindAllDocuments(const std::execution::paral
 	 s.erase(""sv);
 	 matched_words.assign(std::make_move_iterator(s.begin()), std::make_move_iterator(s.end()));
 
-	 return { matched_words, documents_.at(document_id).status };
+	 return { matched_words, documents_[ordinal].status };
 
  }
  
- template <typename ExecutionPolicy, typename DocumentPredicate>
- std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
-	 Query query = ParseQuery(raw_query);
-	 auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+ template <typename Scoring, typename ExecutionPolicy, typename DocumentPredicate>
+ std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count) const {
+	 QueryContext& context = GetThreadQueryContext();
+	 if (context.is_busy_) {
+		 // A predicate runs a query of its own on this thread.
+		 QueryContext nested_context;
+		 return FindTopDocuments<Scoring>(policy, nested_context, raw_query, document_predicate, max_result_count);
+	 }
+	 return FindTopDocuments<Scoring>(policy, context, raw_query, document_predicate, max_result_count);
+ }
 
-	 std::sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-		 if (std::abs(lhs.relevance - rhs.relevance) < eps) {
-			 return lhs.rating > rhs.rating;
+ template <typename Scoring, typename ExecutionPolicy, typename DocumentPredicate>
+ std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, QueryContext& context, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count) const {
+	 std::vector<Document> results;
+	 FindTopDocuments<Scoring>(policy, context, raw_query, document_predicate, max_result_count, results);
+	 return results;
+ }
+
+ template <typename Scoring, typename ExecutionPolicy, typename DocumentPredicate>
+ void SearchServer::FindTopDocuments(const ExecutionPolicy& policy, QueryContext& context, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count, std::vector<Document>& results) const {
+	 const QueryContext::Usage usage(context);
+	 ParseQuery(raw_query, context);
+	 CollectTopDocuments<Scoring>(policy, context, document_predicate, max_result_count, results);
+ }
+
+ template <typename Scoring>
+ void SearchServer::FindTopDocuments(QueryContext& context, std::string_view raw_query, DocumentStatus status, size_t max_result_count, std::vector<Document>& results) const {
+	 FindTopDocuments<Scoring>(std::execution::seq, context, raw_query, StatusFilter{ status }, max_result_count, results);
+ }
+
+ template <typename Scoring, typename DocumentPredicate>
+ void SearchServer::CollectTopDocuments(const std::execution::parallel_policy& policy, QueryContext& context, DocumentPredicate document_predicate, size_t max_result_count, std::vector<Document>& results) const {
+	 auto matched_documents = FindAllDocuments<Scoring>(policy, context, document_predicate);
+
+	 SelectTopDocuments(policy, matched_documents, max_result_count);
+
+	 results.insert(results.end(), matched_documents.begin(), matched_documents.end());
+ }
+
+ template <typename Scoring, typename DocumentPredicate>
+ void SearchServer::CollectTopDocuments(const search_mode::wand_policy&, QueryContext& context, DocumentPredicate document_predicate, size_t max_result_count, std::vector<Document>& results) const {
+	 std::vector<PostingCursor>& cursors = context.cursors_;
+	 cursors.clear();
+	 for (const PostingIndex::TermId term_id : context.plus_terms_) {
+		 const PostingList& postings = index_.GetPostings(term_id);
+		 if (postings.GetDocumentFreq() > 0) {
+			 const double weight = Scoring::ComputeTermWeight(postings, collection_);
+			 cursors.emplace_back(&postings, weight, Scoring::ComputeMaxScore(weight, postings, collection_));
+		 }
+	 }
+
+	 const DocumentBitmap* phrase_documents = GetPhraseDocuments(context);
+
+	 if (max_result_count == 0) {
+		 return;
+	 }
+	 TopDocumentsCollector& top = context.top_;
+	 top.Reset(max_result_count);
+
+	 // Cursors stay where they are; order holds their indices sorted by ordinal. Only a prefix of the order
+	 // moves on each step, and the moved cursors are put back one by one, from the last, by a binary search
+	 // in the sorted rest.
+	 std::vector<uint32_t>& order = context.cursor_order_;
+	 order.resize(cursors.size());
+	 std::iota(order.begin(), order.end(), 0);
+	 std::sort(order.begin(), order.end(), [&cursors](uint32_t lhs, uint32_t rhs) {
+		 return cursors[lhs].ordinal < cursors[rhs].ordinal;
+	 });
+	 const auto count_passed = [&cursors] {
+		 size_t passed_count = 0;
+		 for (const PostingCursor& cursor : cursors) {
+			 passed_count += cursor.position;
+		 }
+		 return passed_count;
+	 };
+	 size_t moved_count = 0;
+	 size_t step_count = 0;
+	 size_t first_passed_count = 0;
+	 while (!order.empty()) {
+		 if (top.IsFull()) {
+			 if (step_count == 0) {
+				 first_passed_count = count_passed();
+			 }
+			 if (++step_count % WAND_CHECK_INTERVAL == 0 && (count_passed() - first_passed_count) * 2 < step_count * (cursors.size() + 2)) {
+				 break;
+			 }
+		 }
+		 for (size_t i = moved_count; i-- > 0;) {
+			 const uint32_t moved = order[i];
+			 const int ordinal = cursors[moved].ordinal;
+			 const auto place = std::partition_point(order.begin() + i + 1, order.end(), [&cursors, ordinal](uint32_t index) {
+				 return cursors[index].ordinal < ordinal;
+			 });
+			 std::move(order.begin() + i + 1, place, order.begin() + i);
+			 *(place - 1) = moved;
+		 }
+		 while (!order.empty() && cursors[order.back()].ordinal == PostingCursor::NO_ORDINAL) {
+			 order.pop_back();
 		 }
-		 else {
-			 return lhs.relevance > rhs.relevance;
+		 if (order.empty()) {
+			 break;
 		 }
+
+		 // A document can enter the result only if its relevance is not below the worst kept one by eps or more.
+		 const double threshold = top.IsFull() ? top.GetWorst().relevance - eps : -1;
+		 double score_bound = 0;
+		 size_t pivot = 0;
+		 while (pivot < order.size()) {
+			 score_bound += cursors[order[pivot]].max_score;
+			 if (score_bound > threshold) {
+				 break;
+			 }
+			 ++pivot;
+		 }
+		 if (pivot == order.size()) {
+			 top.ExtractTo(results);
+			 return;
+		 }
+
+		 const int pivot_ordinal = cursors[order[pivot]].ordinal;
+		 if (cursors[order.front()].ordinal != pivot_ordinal) {
+			 for (size_t i = 0; i < pivot; ++i) {
+				 cursors[order[i]].SeekTo(pivot_ordinal);
+			 }
+			 moved_count = pivot;
+			 continue;
+		 }
+
+		 const PostingCursor& front = cursors[order.front()];
+		 const bool is_accepted = IsAccepted(*front.postings, front.position, document_predicate);
+		 double relevance = 0;
+		 moved_count = 0;
+		 for (const uint32_t index : order) {
+			 PostingCursor& cursor = cursors[index];
+			 if (cursor.ordinal != pivot_ordinal) {
+				 break;
+			 }
+			 relevance += Scoring::Score(cursor.weight, cursor.postings->term_freqs[cursor.position], documents_[pivot_ordinal].word_count, collection_);
+			 cursor.Next();
+			 ++moved_count;
+		 }
+
+		 if (is_accepted && (!top.IsFull() || relevance > top.GetWorst().relevance - eps) && !IsExcluded(context, pivot_ordinal)
+			 && (phrase_documents == nullptr || phrase_documents->Contains(pivot_ordinal))) {
+			 const DocumentData& document_data = documents_[pivot_ordinal];
+			 top.Add({ document_data.id, relevance, document_data.rating });
+		 }
+	 }
+
+	 // Documents below the smallest cursor are decided, and every posting of the others is still ahead of the cursors,
+	 // so the rest of the lists is scored term at a time. The loop above leaves cursors behind only when it gives up.
+	 context.ResetAccumulators(documents_.size());
+	 std::vector<double>& document_to_relevance = context.relevances_;
+	 std::vector<bool>& is_matched = context.is_matched_;
+	 std::vector<int>& matched_ordinals = context.matched_ordinals_;
+	 for (const uint32_t index : order) {
+		 const PostingCursor& cursor = cursors[index];
+		 const PostingList& postings = *cursor.postings;
+		 for (size_t i = cursor.position; i < postings.Size(); ++i) {
+			 const int ordinal = postings.document_ids[i];
+			 if (IsAccepted(postings, i, document_predicate)) {
+				 if (!is_matched[ordinal]) {
+					 is_matched[ordinal] = true;
+					 matched_ordinals.push_back(ordinal);
+				 }
+				 document_to_relevance[ordinal] += Scoring::Score(cursor.weight, postings.term_freqs[i], documents_[ordinal].word_count, collection_);
+			 }
+		 }
+	 }
+	 for (const PostingIndex::TermId term_id : context.minus_terms_) {
+		 index_.GetPostings(term_id).documents.ForEach([&is_matched](uint32_t ordinal) {
+			 is_matched[ordinal] = false;
 		 });
-	 if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		 matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
 	 }
+	 for (const int ordinal : matched_ordinals) {
+		 if (is_matched[ordinal] && (phrase_documents == nullptr || phrase_documents->Contains(ordinal))) {
+			 top.Add({ documents_[ordinal].id, document_to_relevance[ordinal], documents_[ordinal].rating });
+		 }
+	 }
+	 top.ExtractTo(results);
+ }
+
+ template <typename Scoring, typename DocumentPredicate>
+ void SearchServer::CollectTopDocuments(const search_mode::partitioned_policy&, QueryContext& context, DocumentPredicate document_predicate, size_t max_result_count, std::vector<Document>& results) const {
+	 struct TermPostings {
+		 const PostingList* postings;
+		 double weight;
+	 };
+	 std::vector<TermPostings> plus_postings;
+	 for (const PostingIndex::TermId term_id : context.plus_terms_) {
+		 const PostingList& postings = index_.GetPostings(term_id);
+		 if (postings.GetDocumentFreq() > 0) {
+			 plus_postings.push_back({ &postings, Scoring::ComputeTermWeight(postings, collection_) });
+		 }
+	 }
+	 std::vector<const DocumentBitmap*> minus_documents;
+	 for (const PostingIndex::TermId term_id : context.minus_terms_) {
+		 minus_documents.push_back(&index_.GetPostings(term_id).documents);
+	 }
+	 const DocumentBitmap* phrase_documents = GetPhraseDocuments(context);
+
+	 const size_t document_count = documents_.size();
+	 const size_t range_count = std::clamp<size_t>(document_count / MIN_PARTITION_SIZE, 1, std::max(1u, std::thread::hardware_concurrency()) * 4);
+	 const size_t range_size = (document_count + range_count - 1) / range_count;
+	 std::vector<TopDocumentsCollector> range_tops(range_count, TopDocumentsCollector(max_result_count));
+	 std::vector<size_t> ranges(range_count);
+	 std::iota(ranges.begin(), ranges.end(), 0);
+
+	 std::for_each(std::execution::par, ranges.begin(), ranges.end(), [&](size_t range) {
+		 const int first = static_cast<int>(std::min(document_count, range * range_size));
+		 const int last = static_cast<int>(std::min(document_count, (range + 1) * range_size));
+		 // Posting lists are sorted by ordinal, so every range scans its own slice of them.
+		 auto slice = [first, last](const PostingList& postings) {
+			 const auto begin = std::lower_bound(postings.document_ids.begin(), postings.document_ids.end(), first);
+			 return std::pair{ begin - postings.document_ids.begin(), std::lower_bound(begin, postings.document_ids.end(), last) - postings.document_ids.begin() };
+		 };
+
+		 std::vector<double> document_to_relevance(last - first);
+		 std::vector<bool> is_matched(last - first);
+		 for (const auto& [postings, weight] : plus_postings) {
+			 const auto [begin, end] = slice(*postings);
+			 for (auto i = begin; i < end; ++i) {
+				 const int ordinal = postings->document_ids[i];
+				 if (IsAccepted(*postings, i, document_predicate)) {
+					 is_matched[ordinal - first] = true;
+					 document_to_relevance[ordinal - first] += Scoring::Score(weight, postings->term_freqs[i], documents_[ordinal].word_count, collection_);
+				 }
+			 }
+		 }
+		 for (const DocumentBitmap* documents : minus_documents) {
+			 documents->ForEachInRange(first, last, [&is_matched, first](uint32_t ordinal) {
+				 is_matched[ordinal - first] = false;
+			 });
+		 }
 
-	 return matched_documents;
+		 for (int ordinal = first; ordinal < last; ++ordinal) {
+			 if (is_matched[ordinal - first] && (phrase_documents == nullptr || phrase_documents->Contains(ordinal))) {
+				 range_tops[range].Add({ documents_[ordinal].id, document_to_relevance[ordinal - first], documents_[ordinal].rating });
+			 }
+		 }
+	 });
+
+	 TopDocumentsCollector& top = context.top_;
+	 top.Reset(max_result_count);
+	 for (const TopDocumentsCollector& range_top : range_tops) {
+		 top.Merge(range_top);
+	 }
+	 top.ExtractTo(results);
  }
 
- template <typename ExecutionPolicy>
- std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const {
-	 return FindTopDocuments(
-		 policy,
-		 raw_query,
-		 [status](int document_id, DocumentStatus document_status, int rating) {
-			 return document_status == status;
-		 });
+ template <typename Scoring, typename ExecutionPolicy>
+ std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status, size_t max_result_count) const {
+	 return FindTopDocuments<Scoring>(policy, raw_query, StatusFilter{ status }, max_result_count);
  }
- template <typename ExecutionPolicy>
+ template <typename Scoring, typename ExecutionPolicy>
  std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const {
-	 return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+	 return FindTopDocuments<Scoring>(policy, raw_query, DocumentStatus::ACTUAL);
+ }
+
+ template <typename Scoring, typename ExecutionPolicy>
+ std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, QueryContext& context, std::string_view raw_query, DocumentStatus status, size_t max_result_count) const {
+	 return FindTopDocuments<Scoring>(policy, context, raw_query, StatusFilter{ status }, max_result_count);
+ }
+
+ template <typename Scoring, typename ExecutionPolicy>
+ std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, QueryContext& context, std::string_view raw_query) const {
+	 return FindTopDocuments<Scoring>(policy, context, raw_query, DocumentStatus::ACTUAL);
  }
 
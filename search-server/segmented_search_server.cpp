@@ -0,0 +1,293 @@
+#include "segmented_search_server.h"
+#include "string_processing.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+using namespace std;
+
+namespace {
+	set<string, less<>> MakeStopWords(string_view stop_words_text) {
+		const set<string> stop_words = MakeUniqueNonEmptyStrings(SplitIntoWords(stop_words_text));
+		return { stop_words.begin(), stop_words.end() };
+	}
+}
+
+SegmentedSearchServer::SegmentedSearchServer(const string& stop_words_text, size_t memory_segment_capacity)
+	: stop_words_(MakeStopWords(stop_words_text))
+	, memory_segment_capacity_(max<size_t>(1, memory_segment_capacity))
+{
+	if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+		throw invalid_argument("invalid stop word!"s);
+	}
+	merge_thread_ = thread([this] {
+		RunMerges();
+	});
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+	{
+		lock_guard<mutex> lock(segments_mutex_);
+		is_stopping_ = true;
+	}
+	merge_requested_.notify_all();
+	merge_thread_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, const string_view document, DocumentStatus status, const vector<int>& ratings) {
+	if ((document_id < 0) || (document_ids_.count(document_id) > 0)) {
+		throw invalid_argument("invalid document id!"s);
+	}
+	vector<string_view> document_words;
+	if (!SplitIntoValidWords(document, document_words)) {
+		throw invalid_argument("invalid document!"s);
+	}
+	document_words.erase(remove_if(document_words.begin(), document_words.end(), [this](string_view word) {
+		return IsStopWord(word);
+	}), document_words.end());
+
+	vector<TermId> term_ids;
+	term_ids.reserve(document_words.size());
+	for (string_view word : document_words) {
+		term_ids.push_back(terms_.Intern(word));
+	}
+	prefix_terms_.Update(terms_);
+	sort(term_ids.begin(), term_ids.end());
+	vector<SegmentTermCount> terms;
+	for (const TermId term_id : term_ids) {
+		if (terms.empty() || terms.back().term_id != term_id) {
+			terms.push_back({ term_id, 0 });
+		}
+		++terms.back().count;
+	}
+	document_freqs_.resize(terms_.Size());
+	for (const SegmentTermCount& term : terms) {
+		++document_freqs_[term.term_id];
+	}
+
+	memory_segment_.Add({ document_id, ComputeAverageRating(ratings), status, static_cast<int>(document_words.size()) }, move(terms));
+	document_ids_.insert(document_id);
+	if (memory_segment_.GetDocumentCount() >= memory_segment_capacity_) {
+		SealMemorySegment();
+	}
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+	if (document_ids_.erase(document_id) == 0) {
+		return;
+	}
+	vector<SegmentTermCount> terms;
+	if (const int ordinal = memory_segment_.FindOrdinal(document_id); ordinal >= 0) {
+		terms = memory_segment_.GetDocumentTerms(ordinal);
+		memory_segment_.Delete(ordinal);
+	}
+	else {
+		// Seals and merges replace segments, so the lookup and the tombstone are set under the lock.
+		lock_guard<mutex> lock(segments_mutex_);
+		if (const int ordinal = sealing_segment_ ? sealing_segment_->FindOrdinal(document_id) : -1; ordinal >= 0) {
+			terms = sealing_segment_->GetDocumentTerms(ordinal);
+			sealing_segment_->Delete(ordinal);
+		}
+		else {
+			for (const auto& segment : segments_) {
+				if (const int ordinal = segment->FindOrdinal(document_id); ordinal >= 0) {
+					terms = segment->GetDocumentTerms(ordinal);
+					segment->Delete(ordinal);
+					break;
+				}
+			}
+		}
+	}
+	for (const SegmentTermCount& term : terms) {
+		--document_freqs_[term.term_id];
+	}
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(const string_view raw_query, DocumentStatus status, size_t max_result_count) const {
+	return FindTopDocuments(
+		raw_query,
+		[status](int document_id, DocumentStatus document_status, int rating) {
+			return document_status == status;
+		},
+		max_result_count);
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(const string_view raw_query) const {
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+	return document_ids_.size();
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const {
+	lock_guard<mutex> lock(segments_mutex_);
+	return segments_.size();
+}
+
+size_t SegmentedSearchServer::GetMemoryUsage() const {
+	size_t bytes = terms_.GetMemoryUsage() + document_freqs_.capacity() * sizeof(int);
+	for (const auto& segment : GetSegments().sealed) {
+		bytes += segment->GetMemoryUsage();
+	}
+	return bytes;
+}
+
+void SegmentedSearchServer::Flush() {
+	if (memory_segment_.GetDocumentCount() > 0) {
+		SealMemorySegment();
+	}
+}
+
+void SegmentedSearchServer::WaitForMerges() {
+	unique_lock<mutex> lock(segments_mutex_);
+	merge_finished_.wait(lock, [this] {
+		return !is_merging_ && !sealing_segment_ && FindMergeCandidates().empty();
+	});
+}
+
+SegmentedSearchServer::QueryTerms SegmentedSearchServer::ParseQuery(const string_view raw_query) const {
+	vector<string_view> words;
+	vector<QueryWord> query_words;
+	ParseQueryWords(raw_query, [this](string_view word) {
+		return IsStopWord(word);
+	}, words, query_words);
+
+	QueryTerms query;
+	vector<TermId> plus_term_ids;
+	for (const QueryWord& query_word : query_words) {
+		if (query_word.is_stop) {
+			continue;
+		}
+		vector<TermId>& term_ids = query_word.is_minus ? query.minus_terms : plus_term_ids;
+		if (query_word.is_prefix) {
+			prefix_terms_.FindFrequentTerms(query_word.data, MAX_PREFIX_EXPANSIONS, [this](TermId term_id) {
+				return document_freqs_[term_id];
+			}, term_ids);
+			continue;
+		}
+		const TermId term_id = terms_.Find(query_word.data);
+		if (term_id == TermDictionary::NO_TERM) {
+			query.is_empty = query.is_empty || query_word.phrase != QueryWord::NO_PHRASE;
+			continue;
+		}
+		if (query_word.phrase != QueryWord::NO_PHRASE) {
+			query.phrase_terms.push_back(term_id);
+		}
+		term_ids.push_back(term_id);
+	}
+	for (auto* term_ids : { &plus_term_ids, &query.minus_terms, &query.phrase_terms }) {
+		sort(term_ids->begin(), term_ids->end());
+		term_ids->erase(unique(term_ids->begin(), term_ids->end()), term_ids->end());
+	}
+
+	const double log_document_count = log(GetDocumentCount());
+	for (const TermId term_id : plus_term_ids) {
+		if (document_freqs_[term_id] > 0) {
+			query.plus_terms.push_back({ term_id, log_document_count - log(document_freqs_[term_id]) });
+		}
+	}
+	return query;
+}
+
+bool SegmentedSearchServer::IsStopWord(const string_view word) const {
+	return stop_words_.count(word) > 0;
+}
+
+bool SegmentedSearchServer::IsValidWord(const string_view word) {
+	return IsValidText(word);
+}
+
+SegmentedSearchServer::Segments SegmentedSearchServer::GetSegments() const {
+	lock_guard<mutex> lock(segments_mutex_);
+	return { segments_, sealing_segment_ };
+}
+
+void SegmentedSearchServer::SealMemorySegment() {
+	auto segment = make_shared<MemorySegment>(move(memory_segment_));
+	memory_segment_ = MemorySegment();
+	{
+		unique_lock<mutex> lock(segments_mutex_);
+		merge_finished_.wait(lock, [this] {
+			return !sealing_segment_;
+		});
+		sealing_segment_ = move(segment);
+	}
+	merge_requested_.notify_one();
+}
+
+vector<shared_ptr<IndexSegment>> SegmentedSearchServer::FindMergeCandidates() const {
+	// Tier t holds segments of fewer than capacity * MERGE_FACTOR^(t + 1) live documents.
+	vector<vector<shared_ptr<IndexSegment>>> tiers;
+	for (const auto& segment : segments_) {
+		size_t tier = 0;
+		for (size_t bound = memory_segment_capacity_ * MERGE_FACTOR; segment->GetLiveDocumentCount() >= bound; bound *= MERGE_FACTOR) {
+			++tier;
+		}
+		if (tier >= tiers.size()) {
+			tiers.resize(tier + 1);
+		}
+		tiers[tier].push_back(segment);
+		if (tiers[tier].size() == MERGE_FACTOR) {
+			return tiers[tier];
+		}
+	}
+	return {};
+}
+
+void SegmentedSearchServer::RunMerges() {
+	unique_lock<mutex> lock(segments_mutex_);
+	while (true) {
+		vector<shared_ptr<IndexSegment>> sources;
+		merge_requested_.wait(lock, [&] {
+			return is_stopping_ || sealing_segment_ || !(sources = FindMergeCandidates()).empty();
+		});
+		if (is_stopping_) {
+			return;
+		}
+		if (sealing_segment_) {
+			// Seals go first, since the writer waits for them once the next memory segment is full.
+			const shared_ptr<const MemorySegment> source = sealing_segment_;
+			lock.unlock();
+			auto sealed = make_shared<IndexSegment>(source->Seal());
+			lock.lock();
+			for (size_t ordinal = 0; ordinal < source->GetDocumentCount(); ++ordinal) {
+				if (source->IsDeleted(ordinal)) {
+					sealed->Delete(ordinal);
+				}
+			}
+			if (sealed->GetLiveDocumentCount() > 0) {
+				segments_.push_back(move(sealed));
+			}
+			sealing_segment_.reset();
+			merge_finished_.notify_all();
+			continue;
+		}
+		is_merging_ = true;
+		lock.unlock();
+
+		vector<const IndexSegment*> source_segments;
+		for (const auto& source : sources) {
+			source_segments.push_back(source.get());
+		}
+		vector<vector<int>> new_ordinals;
+		auto merged = make_shared<IndexSegment>(IndexSegment::Merge(source_segments, new_ordinals));
+
+		lock.lock();
+		// Documents removed while the merge was running are still live in the merged segment.
+		for (size_t i = 0; i < sources.size(); ++i) {
+			for (size_t ordinal = 0; ordinal < sources[i]->GetDocumentCount(); ++ordinal) {
+				if (new_ordinals[i][ordinal] >= 0 && sources[i]->IsDeleted(ordinal)) {
+					merged->Delete(new_ordinals[i][ordinal]);
+				}
+			}
+		}
+		segments_.erase(remove_if(segments_.begin(), segments_.end(), [&](const shared_ptr<IndexSegment>& segment) {
+			return find(sources.begin(), sources.end(), segment) != sources.end();
+		}), segments_.end());
+		if (merged->GetLiveDocumentCount() > 0) {
+			segments_.push_back(move(merged));
+		}
+		is_merging_ = false;
+		merge_finished_.notify_all();
+	}
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include "document.h"
+#include "index_segment.h"
+#include "prefix_term_index.h"
+#include "query_parser.h"
+#include "term_dictionary.h"
+#include "top_documents.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Log-structured variant of the search server. New documents go to a small memory segment; a full
+// one is handed to a background thread, which seals it into an immutable compressed segment while
+// a fresh memory segment takes new documents, and which merges sealed segments of similar size.
+// An update waits only if the previous memory segment is not sealed yet when the next one fills up.
+// Removed documents are marked in tombstone bitmaps and dropped by the next merge. Queries fan out
+// over all segments with global IDF, so the results are the same as from a single index.
+// Queries have the syntax of SearchServer, but segments keep no positions: the words of a quoted
+// phrase must all occur in a document, in any order.
+// Like SearchServer, queries may run concurrently with each other but not with updates;
+// background seals and merges never block either.
+class SegmentedSearchServer {
+public:
+	static constexpr size_t DEFAULT_MEMORY_SEGMENT_CAPACITY = 4096;
+	// Number of segments of one size tier that are merged together.
+	static constexpr size_t MERGE_FACTOR = 4;
+
+	explicit SegmentedSearchServer(const std::string& stop_words_text, size_t memory_segment_capacity = DEFAULT_MEMORY_SEGMENT_CAPACITY);
+	~SegmentedSearchServer();
+
+	SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+	SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+	void RemoveDocument(int document_id);
+
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+	int GetDocumentCount() const;
+	size_t GetSegmentCount() const;
+	size_t GetMemoryUsage() const;
+
+	// Hands the memory segment to the background thread even if it is not full.
+	void Flush();
+	// Blocks until the background thread has no segments left to seal or merge.
+	void WaitForMerges();
+
+private:
+	using TermId = TermDictionary::TermId;
+
+	struct QueryTerms {
+		std::vector<std::pair<TermId, double>> plus_terms;
+		std::vector<TermId> minus_terms;
+		// Distinct terms of the phrases, which a document must all contain.
+		std::vector<TermId> phrase_terms;
+		// A phrase has a word that no document contains.
+		bool is_empty = false;
+	};
+
+	struct Segments {
+		std::vector<std::shared_ptr<IndexSegment>> sealed;
+		std::shared_ptr<const MemorySegment> sealing;
+	};
+
+	const std::set<std::string, std::less<>> stop_words_;
+	const size_t memory_segment_capacity_;
+	TermDictionary terms_;
+	PrefixTermIndex prefix_terms_;
+	// Number of live documents containing every term.
+	std::vector<int> document_freqs_;
+	std::unordered_set<int> document_ids_;
+	MemorySegment memory_segment_;
+
+	mutable std::mutex segments_mutex_;
+	std::vector<std::shared_ptr<IndexSegment>> segments_;
+	// Full memory segment that the background thread is sealing. Only its tombstones change.
+	std::shared_ptr<MemorySegment> sealing_segment_;
+	std::condition_variable merge_requested_;
+	std::condition_variable merge_finished_;
+	bool is_merging_ = false;
+	bool is_stopping_ = false;
+	std::thread merge_thread_;
+
+	QueryTerms ParseQuery(std::string_view raw_query) const;
+	bool IsStopWord(std::string_view word) const;
+	static bool IsValidWord(std::string_view word);
+
+	// Sealed segments and the one being sealed, taken together so that a seal finishing in between
+	// neither hides its documents nor shows them twice.
+	Segments GetSegments() const;
+	// Waits for the previous memory segment to be sealed and hands over the current one.
+	void SealMemorySegment();
+	// Picks MERGE_FACTOR segments of one tier; empty if there is nothing to merge.
+	std::vector<std::shared_ptr<IndexSegment>> FindMergeCandidates() const;
+	void RunMerges();
+
+	template <typename Segment, typename DocumentPredicate>
+	void CollectSegment(const Segment& segment, const QueryTerms& query, DocumentPredicate document_predicate, TopDocumentsCollector& top) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count) const {
+	const QueryTerms query = ParseQuery(raw_query);
+	TopDocumentsCollector top(max_result_count);
+	if (query.is_empty) {
+		return top.Extract();
+	}
+	const Segments segments = GetSegments();
+	for (const auto& segment : segments.sealed) {
+		CollectSegment(*segment, query, document_predicate, top);
+	}
+	if (segments.sealing) {
+		CollectSegment(*segments.sealing, query, document_predicate, top);
+	}
+	CollectSegment(memory_segment_, query, document_predicate, top);
+	return top.Extract();
+}
+
+template <typename Segment, typename DocumentPredicate>
+void SegmentedSearchServer::CollectSegment(const Segment& segment, const QueryTerms& query, DocumentPredicate document_predicate, TopDocumentsCollector& top) const {
+	std::vector<double> document_to_relevance(segment.GetDocumentCount());
+	std::vector<bool> is_matched(segment.GetDocumentCount());
+	std::vector<int> matched_ordinals;
+	for (const auto& [term_id, inverse_document_freq] : query.plus_terms) {
+		segment.ForEachPosting(term_id, [&](int ordinal, uint32_t count) {
+			const SegmentDocument& document = segment.GetDocument(ordinal);
+			if (segment.IsDeleted(ordinal) || !document_predicate(document.id, document.status, document.rating)) {
+				return;
+			}
+			if (!is_matched[ordinal]) {
+				is_matched[ordinal] = true;
+				matched_ordinals.push_back(ordinal);
+			}
+			document_to_relevance[ordinal] += count * inverse_document_freq / document.word_count;
+		});
+	}
+	for (const TermId term_id : query.minus_terms) {
+		segment.ForEachPosting(term_id, [&](int ordinal, uint32_t) {
+			is_matched[ordinal] = false;
+		});
+	}
+	std::vector<uint32_t> phrase_term_counts(query.phrase_terms.empty() ? 0 : segment.GetDocumentCount());
+	for (const TermId term_id : query.phrase_terms) {
+		segment.ForEachPosting(term_id, [&](int ordinal, uint32_t) {
+			++phrase_term_counts[ordinal];
+		});
+	}
+	for (const int ordinal : matched_ordinals) {
+		if (is_matched[ordinal] && (query.phrase_terms.empty() || phrase_term_counts[ordinal] == query.phrase_terms.size())) {
+			const SegmentDocument& document = segment.GetDocument(ordinal);
+			top.Add({ document.id, document_to_relevance[ordinal], document.rating });
+		}
+	}
+}
@@ -0,0 +1,165 @@
+#include "snapshot.h"
+#include <fstream>
+#include <iterator>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SNAPSHOT_USE_MMAP
+#endif
+using namespace std;
+
+namespace {
+	constexpr char SNAPSHOT_MAGIC[8] = { 'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P' };
+	constexpr uint32_t SNAPSHOT_VERSION = 3;
+	// Written in the native byte order; a snapshot from a machine with another byte order is rejected.
+	constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	struct SnapshotHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		uint64_t payload_size;
+		uint64_t checksum;
+	};
+	static_assert(sizeof(SnapshotHeader) % SnapshotWriter::ALIGNMENT == 0);
+
+	// FNV-1a over 64-bit words, then over the trailing bytes.
+	uint64_t ComputeChecksum(const char* data, size_t size) {
+		constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+		uint64_t hash = 0xcbf29ce484222325ull;
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, data + i, sizeof(word));
+			hash = (hash ^ word) * FNV_PRIME;
+		}
+		for (; i < size; ++i) {
+			hash = (hash ^ static_cast<unsigned char>(data[i])) * FNV_PRIME;
+		}
+		return hash;
+	}
+}
+
+MappedFile::MappedFile(const string& path) {
+#ifdef SNAPSHOT_USE_MMAP
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw runtime_error("cannot open "s + path);
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0) {
+		close(fd);
+		throw runtime_error("cannot read "s + path);
+	}
+	size_ = static_cast<size_t>(file_stat.st_size);
+	if (size_ > 0) {
+		void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			close(fd);
+			throw runtime_error("cannot map "s + path);
+		}
+		data_ = static_cast<const char*>(data);
+		is_mapped_ = true;
+	}
+	close(fd);
+#else
+	ifstream input(path, ios::binary);
+	if (!input) {
+		throw runtime_error("cannot open "s + path);
+	}
+	buffer_.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+	data_ = buffer_.data();
+	size_ = buffer_.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef SNAPSHOT_USE_MMAP
+	if (is_mapped_) {
+		munmap(const_cast<char*>(data_), size_);
+	}
+#endif
+}
+
+const char* MappedFile::GetData() const {
+	return data_;
+}
+
+size_t MappedFile::GetSize() const {
+	return size_;
+}
+
+void SnapshotWriter::WriteString(string_view str) {
+	Write<uint64_t>(str.size());
+	payload_.append(str.data(), str.size());
+}
+
+void SnapshotWriter::SaveToFile(const string& path) const {
+	SnapshotHeader header;
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.byte_order = BYTE_ORDER_MARK;
+	header.payload_size = payload_.size();
+	header.checksum = ComputeChecksum(payload_.data(), payload_.size());
+
+	ofstream output(path, ios::binary | ios::trunc);
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(payload_.data(), payload_.size());
+	if (!output) {
+		throw runtime_error("cannot write "s + path);
+	}
+}
+
+void SnapshotWriter::Align() {
+	payload_.resize((payload_.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+}
+
+SnapshotReader::SnapshotReader(const MappedFile& file) {
+	SnapshotHeader header;
+	if (file.GetSize() < sizeof(header)) {
+		throw runtime_error("not a snapshot");
+	}
+	memcpy(&header, file.GetData(), sizeof(header));
+	if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+		throw runtime_error("not a snapshot");
+	}
+	if (header.version != SNAPSHOT_VERSION || header.byte_order != BYTE_ORDER_MARK) {
+		throw runtime_error("unsupported snapshot version");
+	}
+	if (header.payload_size != file.GetSize() - sizeof(header)) {
+		throw runtime_error("corrupted snapshot");
+	}
+	begin_ = position_ = file.GetData() + sizeof(header);
+	end_ = begin_ + header.payload_size;
+	if (ComputeChecksum(begin_, header.payload_size) != header.checksum) {
+		throw runtime_error("corrupted snapshot");
+	}
+}
+
+string_view SnapshotReader::ReadString() {
+	const uint64_t size = Read<uint64_t>();
+	if (size > static_cast<size_t>(end_ - position_)) {
+		throw runtime_error("corrupted snapshot");
+	}
+	return { Take(size), size };
+}
+
+bool SnapshotReader::IsEnd() const {
+	return position_ == end_;
+}
+
+const char* SnapshotReader::Take(size_t size) {
+	if (size > static_cast<size_t>(end_ - position_)) {
+		throw runtime_error("corrupted snapshot");
+	}
+	const char* data = position_;
+	position_ += size;
+	return data;
+}
+
+void SnapshotReader::Align() {
+	const size_t offset = position_ - begin_;
+	Take((offset + SnapshotWriter::ALIGNMENT - 1) / SnapshotWriter::ALIGNMENT * SnapshotWriter::ALIGNMENT - offset);
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Read-only contents of a file, memory-mapped where the platform supports it.
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* GetData() const;
+	size_t GetSize() const;
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	bool is_mapped_ = false;
+	std::vector<char> buffer_;
+};
+
+// Snapshot file: a header with a format version and a checksum of the payload, then the payload.
+// Arrays in the payload are 8-byte aligned, so that a mapped file can be read in place.
+class SnapshotWriter {
+public:
+	static constexpr size_t ALIGNMENT = 8;
+
+	template <typename T>
+	void Write(const T& value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		payload_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	// Writes the element count followed by the aligned elements.
+	template <typename T>
+	void WriteArray(const T* data, size_t count) {
+		static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= ALIGNMENT);
+		Write<uint64_t>(count);
+		Align();
+		payload_.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+		Align();
+	}
+
+	void WriteString(std::string_view str);
+
+	void SaveToFile(const std::string& path) const;
+
+private:
+	std::string payload_;
+
+	void Align();
+};
+
+// Validates the header and the checksum on construction; every read is bounds-checked.
+// Arrays and strings are returned as views into the file.
+class SnapshotReader {
+public:
+	explicit SnapshotReader(const MappedFile& file);
+
+	template <typename T>
+	T Read() {
+		static_assert(std::is_trivially_copyable_v<T>);
+		T value;
+		std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+		return value;
+	}
+
+	template <typename T>
+	std::pair<const T*, size_t> ReadArray() {
+		static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= SnapshotWriter::ALIGNMENT);
+		const uint64_t count = Read<uint64_t>();
+		Align();
+		if (count > static_cast<size_t>(end_ - position_) / sizeof(T)) {
+			throw std::runtime_error("corrupted snapshot");
+		}
+		const T* data = reinterpret_cast<const T*>(Take(count * sizeof(T)));
+		Align();
+		return { data, count };
+	}
+
+	std::string_view ReadString();
+
+	bool IsEnd() const;
+
+private:
+	const char* begin_;
+	const char* position_;
+	const char* end_;
+
+	const char* Take(size_t size);
+	void Align();
+};
@@ -1,23 +1,131 @@
 #include "string_processing.h"
+#include <cstdint>
 #include <iostream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define STRING_PROCESSING_USE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STRING_PROCESSING_USE_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 using namespace std;
 
-vector<string_view> SplitIntoWords(string_view str) {
-	vector<string_view> result;
-	while (true) {
-		const auto space = str.find(' ');
-		if (space != 0 && !str.empty()) {
-			result.push_back(str.substr(0, space));
-		}
-		if (space == str.npos) {
-			break;
+namespace {
+	// Bit i of a mask describes byte i of a block.
+	struct BlockMasks {
+		uint32_t spaces;
+		uint32_t controls;
+	};
+
+	// Control characters are compared as signed bytes, like the char comparisons of the scalar path,
+	// so bytes of 0x80 and above are never control characters.
+#if defined(STRING_PROCESSING_USE_AVX2)
+	constexpr size_t BLOCK_SIZE = 32;
+
+	BlockMasks ScanBlock(const char* data) {
+		const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+		const __m256i spaces = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+		const __m256i controls = _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(' '), bytes), _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(-1)));
+		return { static_cast<uint32_t>(_mm256_movemask_epi8(spaces)), static_cast<uint32_t>(_mm256_movemask_epi8(controls)) };
+	}
+#elif defined(STRING_PROCESSING_USE_SSE2)
+	constexpr size_t BLOCK_SIZE = 16;
+
+	BlockMasks ScanBlock(const char* data) {
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+		const __m128i spaces = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+		const __m128i controls = _mm_and_si128(_mm_cmplt_epi8(bytes, _mm_set1_epi8(' ')), _mm_cmpgt_epi8(bytes, _mm_set1_epi8(-1)));
+		return { static_cast<uint32_t>(_mm_movemask_epi8(spaces)), static_cast<uint32_t>(_mm_movemask_epi8(controls)) };
+	}
+#endif
+
+#if defined(STRING_PROCESSING_USE_AVX2) || defined(STRING_PROCESSING_USE_SSE2)
+	int CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+#endif
+
+	bool IsControl(char c) {
+		return c >= '\0' && c < ' ';
+	}
+
+	// One pass over the text: whole blocks are classified by the vector unit and only the
+	// separators found in them are visited; the tail is scanned byte by byte.
+	template <bool validate>
+	bool Tokenize(const string_view str, vector<string_view>& words) {
+		const char* const data = str.data();
+		size_t word_start = 0;
+		const auto end_word = [&](size_t separator) {
+			if (separator > word_start) {
+				words.push_back(str.substr(word_start, separator - word_start));
+			}
+			word_start = separator + 1;
+		};
+
+		size_t position = 0;
+#if defined(STRING_PROCESSING_USE_AVX2) || defined(STRING_PROCESSING_USE_SSE2)
+		for (; position + BLOCK_SIZE <= str.size(); position += BLOCK_SIZE) {
+			const BlockMasks masks = ScanBlock(data + position);
+			if (validate && masks.controls != 0) {
+				return false;
+			}
+			for (uint32_t spaces = masks.spaces; spaces != 0; spaces &= spaces - 1) {
+				end_word(position + CountTrailingZeros(spaces));
+			}
 		}
-		else {
-			str.remove_prefix(space + 1);
+#endif
+		for (; position < str.size(); ++position) {
+			if (data[position] == ' ') {
+				end_word(position);
+			}
+			else if (validate && IsControl(data[position])) {
+				return false;
+			}
 		}
+		end_word(str.size());
+		return true;
 	}
+}
+
+vector<string_view> SplitIntoWords(string_view str) {
+	vector<string_view> result;
+	Tokenize<false>(str, result);
 	return result;
 }
 
+void SplitIntoWords(string_view str, vector<string_view>& words) {
+	Tokenize<false>(str, words);
+}
 
+bool SplitIntoValidWords(string_view str, vector<string_view>& words) {
+	return Tokenize<true>(str, words);
+}
 
+bool IsValidText(string_view str) {
+	size_t position = 0;
+#if defined(STRING_PROCESSING_USE_AVX2) || defined(STRING_PROCESSING_USE_SSE2)
+	for (; position + BLOCK_SIZE <= str.size(); position += BLOCK_SIZE) {
+		if (ScanBlock(str.data() + position).controls != 0) {
+			return false;
+		}
+	}
+#endif
+	for (; position < str.size(); ++position) {
+		if (IsControl(str[position])) {
+			return false;
+		}
+	}
+	return true;
+}
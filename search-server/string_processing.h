@@ -16,3 +16,13 @@
 	}
 
 	std::vector<std::string_view> SplitIntoWords(std::string_view str);
+
+	// Appends the words of str to words, so that one buffer can be reused for many texts.
+	void SplitIntoWords(std::string_view str, std::vector<std::string_view>& words);
+
+	// Same as SplitIntoWords, but fails on control characters (0x00-0x1F) in the same pass;
+	// words are left partially filled then.
+	bool SplitIntoValidWords(std::string_view str, std::vector<std::string_view>& words);
+
+	// True if str has no control characters.
+	bool IsValidText(std::string_view str);
@@ -0,0 +1,59 @@
+#include "term_dictionary.h"
+#include <algorithm>
+using namespace std;
+
+TermDictionary::TermId TermDictionary::Intern(string_view term) {
+	if (const auto it = term_ids_.find(term); it != term_ids_.end()) {
+		return it->second;
+	}
+	return Add(Store(term));
+}
+
+TermDictionary::TermId TermDictionary::InternExternal(string_view term) {
+	if (const auto it = term_ids_.find(term); it != term_ids_.end()) {
+		return it->second;
+	}
+	return Add(term);
+}
+
+TermDictionary::TermId TermDictionary::Find(string_view term) const {
+	const auto it = term_ids_.find(term);
+	return it == term_ids_.end() ? NO_TERM : it->second;
+}
+
+string_view TermDictionary::GetTerm(TermId term_id) const {
+	return terms_[term_id];
+}
+
+size_t TermDictionary::Size() const {
+	return terms_.size();
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+	// Hash nodes hold the key, the id and the next pointer; buckets are one pointer each.
+	const size_t hash_node_bytes = sizeof(pair<const string_view, TermId>) + sizeof(void*);
+	return sizeof(*this) + arena_bytes_ + terms_.capacity() * sizeof(string_view)
+		+ term_ids_.size() * hash_node_bytes + term_ids_.bucket_count() * sizeof(void*);
+}
+
+TermDictionary::TermId TermDictionary::Add(string_view stored_term) {
+	const TermId term_id = static_cast<TermId>(terms_.size());
+	terms_.push_back(stored_term);
+	term_ids_.emplace(stored_term, term_id);
+	return term_id;
+}
+
+string_view TermDictionary::Store(string_view term) {
+	if (term.size() > chunk_free_size_) {
+		const size_t chunk_size = max(ARENA_CHUNK_SIZE, term.size());
+		chunks_.push_back(make_unique<char[]>(chunk_size));
+		chunk_free_begin_ = chunks_.back().get();
+		chunk_free_size_ = chunk_size;
+		arena_bytes_ += chunk_size;
+	}
+	char* stored = chunk_free_begin_;
+	copy(term.begin(), term.end(), stored);
+	chunk_free_begin_ += term.size();
+	chunk_free_size_ -= term.size();
+	return { stored, term.size() };
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Interns every distinct term once into an append-only arena and numbers terms densely.
+// Views returned by the dictionary stay valid for its whole lifetime.
+class TermDictionary {
+public:
+	using TermId = uint32_t;
+	static constexpr TermId NO_TERM = std::numeric_limits<TermId>::max();
+
+	TermId Intern(std::string_view term);
+	// Interns a term without copying it; the caller keeps its storage alive as long as the dictionary.
+	TermId InternExternal(std::string_view term);
+	TermId Find(std::string_view term) const;
+	std::string_view GetTerm(TermId term_id) const;
+
+	size_t Size() const;
+	size_t GetMemoryUsage() const;
+
+private:
+	static constexpr size_t ARENA_CHUNK_SIZE = 64 * 1024;
+
+	std::vector<std::unique_ptr<char[]>> chunks_;
+	char* chunk_free_begin_ = nullptr;
+	size_t chunk_free_size_ = 0;
+	size_t arena_bytes_ = 0;
+	std::vector<std::string_view> terms_;
+	std::unordered_map<std::string_view, TermId> term_ids_;
+
+	std::string_view Store(std::string_view term);
+	TermId Add(std::string_view stored_term);
+};
@@ -0,0 +1,63 @@
+#include "top_documents.h"
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+	if (abs(lhs.relevance - rhs.relevance) < eps) {
+		return lhs.rating > rhs.rating;
+	}
+	return lhs.relevance > rhs.relevance;
+}
+
+TopDocumentsCollector::TopDocumentsCollector(size_t max_count)
+	: max_count_(max_count)
+{
+	heap_.reserve(max_count_);
+}
+
+void TopDocumentsCollector::Add(const Document& document) {
+	if (max_count_ == 0) {
+		return;
+	}
+	if (heap_.size() < max_count_) {
+		heap_.push_back(document);
+		push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	}
+	else if (IsMoreRelevant(document, heap_.front())) {
+		pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+		heap_.back() = document;
+		push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	}
+}
+
+void TopDocumentsCollector::Merge(const TopDocumentsCollector& other) {
+	for (const Document& document : other.heap_) {
+		Add(document);
+	}
+}
+
+bool TopDocumentsCollector::IsFull() const {
+	return max_count_ > 0 && heap_.size() == max_count_;
+}
+
+const Document& TopDocumentsCollector::GetWorst() const {
+	return heap_.front();
+}
+
+vector<Document> TopDocumentsCollector::Extract() {
+	sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	return move(heap_);
+}
+
+void TopDocumentsCollector::ExtractTo(vector<Document>& documents) {
+	sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	documents.insert(documents.end(), heap_.begin(), heap_.end());
+	heap_.clear();
+}
+
+void TopDocumentsCollector::Reset(size_t max_count) {
+	max_count_ = max_count;
+	heap_.clear();
+	heap_.reserve(max_count_);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "document.h"
+#include <cstddef>
+#include <vector>
+
+const int MAX_RESULT_DOCUMENT_COUNT = 5;
+const double eps = 1e-6;
+
+// Ranking order of search results: higher relevance first, ties within eps broken by rating.
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+// Keeps the best max_count documents seen so far in a bounded heap whose top is the worst kept one.
+class TopDocumentsCollector {
+public:
+	explicit TopDocumentsCollector(size_t max_count);
+
+	void Add(const Document& document);
+	void Merge(const TopDocumentsCollector& other);
+
+	bool IsFull() const;
+	const Document& GetWorst() const;
+
+	std::vector<Document> Extract();
+	// Appends the kept documents, best first, to documents and empties the collector, which keeps its memory.
+	void ExtractTo(std::vector<Document>& documents);
+	// Empties the collector for a new query, keeping its memory.
+	void Reset(size_t max_count);
+
+private:
+	size_t max_count_;
+	std::vector<Document> heap_;
+};